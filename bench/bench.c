@@ -0,0 +1,485 @@
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "chash.h"
+
+// Benchmark Definitions
+#define BENCH_DEFAULT_KEYS 100000
+#define BENCH_DEFAULT_OPERATIONS 1000000
+#define BENCH_DEFAULT_KEY_LENGTH 16
+
+// Base-36 digits of the largest key index, the least room any key can need
+#define BENCH_INDEX_DIGITS 7
+
+// Latencies are kept in a log-linear histogram: 16 linear steps within every power of two
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS (64 * LATENCY_SUB_BUCKETS)
+
+// Operations the workload mixes
+#define BENCH_READ 0
+#define BENCH_WRITE 1
+#define BENCH_DELETE 2
+
+// Workload shared by every benchmark thread
+typedef struct bench_workload
+{
+	int keyCount;
+	char* keyData;
+	size_t* keyOffsets;
+	size_t* keyLengths;
+
+	int readPercent;
+	int writePercent;
+
+	// Zipfian skew over the keys, uniform when theta is 0
+	double theta;
+	double zetaN;
+	double alpha;
+	double eta;
+
+	chashTable* table;
+	long operations;
+	int batch;
+	int timed;
+	uint64_t seed;
+
+	pthread_barrier_t start;
+
+} benchWorkload;
+
+// One benchmark thread's share of the run and its results
+typedef struct bench_thread
+{
+	pthread_t thread;
+	benchWorkload* workload;
+	int index;
+	long operations;
+
+	uint64_t elapsedNanos;
+	uint64_t calls;
+	uint64_t latencies[LATENCY_BUCKETS];
+
+} benchThread;
+
+// Function that reads the monotonic clock in nanoseconds.
+static uint64_t benchClock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// Function that advances a xorshift64* generator and returns its next value.
+static uint64_t nextRandom(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Function that returns a random double in [0, 1).
+static double nextUnit(uint64_t* state) {
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Function that picks the next key, skewed towards low indices when theta is set.
+// Uses the Gray et al. Zipfian generator, which needs the zeta constant computed once up front.
+static int nextKey(const benchWorkload* workload, uint64_t* state) {
+    if (workload->theta == 0.0) {
+        return (int)(nextRandom(state) % (uint64_t)workload->keyCount);
+    }
+
+    double u = nextUnit(state);
+    double uz = u * workload->zetaN;
+    if (uz < 1.0) {
+        return 0;
+    }
+    if (uz < 1.0 + pow(0.5, workload->theta)) {
+        return 1;
+    }
+
+    int key = (int)(workload->keyCount * pow(workload->eta * u - workload->eta + 1.0, workload->alpha));
+    return key < workload->keyCount ? key : workload->keyCount - 1;
+}
+
+// Function that picks the next operation according to the read/write/delete mix.
+static int nextOperation(const benchWorkload* workload, uint64_t* state) {
+    int roll = (int)(nextRandom(state) % 100);
+    if (roll < workload->readPercent) {
+        return BENCH_READ;
+    }
+    if (roll < workload->readPercent + workload->writePercent) {
+        return BENCH_WRITE;
+    }
+    return BENCH_DELETE;
+}
+
+// Function that returns the histogram bucket of a latency.
+static int latencyBucket(uint64_t nanos) {
+    if (nanos < LATENCY_SUB_BUCKETS) {
+        return (int)nanos;
+    }
+
+    int exponent = 63 - __builtin_clzll(nanos);
+    int sub = (int)(nanos >> (exponent - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return (exponent - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+// Function that returns the smallest latency a histogram bucket holds.
+static uint64_t latencyValue(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+
+    int exponent = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket % LATENCY_SUB_BUCKETS);
+    return (1ULL << exponent) | (sub << (exponent - LATENCY_SUB_BITS));
+}
+
+// Function that returns the latency below which the given fraction of calls finished.
+static uint64_t latencyPercentile(const uint64_t* histogram, uint64_t calls, double fraction) {
+    uint64_t rank = (uint64_t)(fraction * calls);
+    uint64_t seen = 0;
+
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += histogram[bucket];
+        if (seen > rank) {
+            return latencyValue(bucket);
+        }
+    }
+    return latencyValue(LATENCY_BUCKETS - 1);
+}
+
+// Function that generates every key up front. Each key starts with its index in base 36,
+// which keeps them unique, and is padded with upper-case letters to a length drawn
+// uniformly between the minimum and maximum. Keys shorter than their index come out longer.
+static int generateKeys(benchWorkload* workload, int minLength, int maxLength) {
+    uint64_t state = workload->seed ^ 0x9E3779B97F4A7C15ULL;
+    size_t total = 0;
+
+    workload->keyOffsets = (size_t*)malloc(workload->keyCount * sizeof(size_t));
+    workload->keyLengths = (size_t*)malloc(workload->keyCount * sizeof(size_t));
+    if (workload->keyOffsets == NULL || workload->keyLengths == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < workload->keyCount; i++) {
+        workload->keyLengths[i] = (size_t)(minLength + (int)(nextRandom(&state) % (uint64_t)(maxLength - minLength + 1)));
+        workload->keyOffsets[i] = total;
+        total += workload->keyLengths[i] > BENCH_INDEX_DIGITS ? workload->keyLengths[i] : BENCH_INDEX_DIGITS;
+    }
+
+    workload->keyData = (char*)malloc(total);
+    if (workload->keyData == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < workload->keyCount; i++) {
+        char* key = workload->keyData + workload->keyOffsets[i];
+        size_t length = 0;
+
+        for (unsigned index = (unsigned)i;; index /= 36) {
+            key[length++] = "0123456789abcdefghijklmnopqrstuvwxyz"[index % 36];
+            if (index < 36)
+                break;
+        }
+        while (length < workload->keyLengths[i]) {
+            key[length++] = (char)('A' + nextRandom(&state) % 26);
+        }
+        workload->keyLengths[i] = length;
+    }
+
+    return 0;
+}
+
+// Function that runs one operation, or a batch of operations of one kind, on the given keys.
+static void runOperation(chashTable* table, int operation, const uint8_t** keys, size_t* lengths, uint32_t* values, uint8_t* found, int count) {
+    if (count == 1) {
+        if (operation == BENCH_READ) {
+            chashSearch(table, keys[0], lengths[0], &values[0]);
+        }
+        else if (operation == BENCH_WRITE) {
+            chashInsert(table, keys[0], lengths[0], values[0]);
+        }
+        else {
+            chashDelete(table, keys[0], lengths[0]);
+        }
+        return;
+    }
+
+    if (operation == BENCH_READ) {
+        chashSearchBatch(table, keys, lengths, NULL, count, values, found);
+    }
+    else if (operation == BENCH_WRITE) {
+        chashInsertBatch(table, keys, lengths, NULL, values, count);
+    }
+    else {
+        chashDeleteBatch(table, keys, lengths, NULL, count);
+    }
+}
+
+// Function that each benchmark thread runs, timing every call.
+static void* benchWorker(void* arg) {
+    benchThread* self = (benchThread*)arg;
+    benchWorkload* workload = self->workload;
+    uint64_t state = workload->seed + 0x632BE59BD9B4E019ULL * (uint64_t)(self->index + 1);
+
+    const uint8_t** keys = (const uint8_t**)malloc(workload->batch * sizeof(uint8_t*));
+    size_t* lengths = (size_t*)malloc(workload->batch * sizeof(size_t));
+    uint32_t* values = (uint32_t*)malloc(workload->batch * sizeof(uint32_t));
+    uint8_t* found = (uint8_t*)malloc(workload->batch);
+    if (keys == NULL || lengths == NULL || values == NULL || found == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to benchmark thread.\n");
+        abort();
+    }
+
+    pthread_barrier_wait(&workload->start);
+    uint64_t started = benchClock();
+
+    for (long done = 0; done < self->operations;) {
+        int operation = nextOperation(workload, &state);
+        int count = workload->batch;
+        if (count > self->operations - done) {
+            count = (int)(self->operations - done);
+        }
+
+        for (int i = 0; i < count; i++) {
+            int key = nextKey(workload, &state);
+            keys[i] = (const uint8_t*)workload->keyData + workload->keyOffsets[key];
+            lengths[i] = workload->keyLengths[key];
+            values[i] = (uint32_t)nextRandom(&state);
+        }
+
+        if (workload->timed) {
+            uint64_t before = benchClock();
+            runOperation(workload->table, operation, keys, lengths, values, found, count);
+            self->latencies[latencyBucket(benchClock() - before)]++;
+        }
+        else {
+            runOperation(workload->table, operation, keys, lengths, values, found, count);
+        }
+
+        self->calls++;
+        done += count;
+    }
+
+    self->elapsedNanos = benchClock() - started;
+
+    free(keys);
+    free(lengths);
+    free(values);
+    free(found);
+    return NULL;
+}
+
+// Function that prints the benchmark options.
+static void printBenchUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [-t threads] [-k keys] [-o operations] [-r read %%] [-w write %%] "
+        "[-z zipf theta] [-l min key length] [-L max key length] [-p prefill %%] [-b batch] "
+        "[-e chained|flat] [-H jenkins|wyhash|xxhash] [-s stripes] [-S seed] [-x]\n", program);
+}
+
+// Main function of the benchmark.
+int main(int argc, char* argv[]) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = processors > 0 ? (int)processors : 1;
+    int minLength = BENCH_DEFAULT_KEY_LENGTH;
+    int maxLength = BENCH_DEFAULT_KEY_LENGTH;
+    int prefillPercent = 100;
+    int stripeOption = 0;
+    const char* engineName = "chained";
+    const char* hashName = NULL;
+
+    benchWorkload workload;
+    memset(&workload, 0, sizeof(workload));
+    workload.keyCount = BENCH_DEFAULT_KEYS;
+    workload.operations = BENCH_DEFAULT_OPERATIONS;
+    workload.readPercent = 80;
+    workload.writePercent = 15;
+    workload.batch = 1;
+    workload.timed = 1;
+    workload.seed = 1;
+
+    int option;
+    while ((option = getopt(argc, argv, "t:k:o:r:w:z:l:L:p:b:e:H:s:S:xh")) != -1) {
+        switch (option) {
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'k':
+            workload.keyCount = atoi(optarg);
+            break;
+        case 'o':
+            workload.operations = atol(optarg);
+            break;
+        case 'r':
+            workload.readPercent = atoi(optarg);
+            break;
+        case 'w':
+            workload.writePercent = atoi(optarg);
+            break;
+        case 'z':
+            workload.theta = atof(optarg);
+            break;
+        case 'l':
+            minLength = atoi(optarg);
+            break;
+        case 'L':
+            maxLength = atoi(optarg);
+            break;
+        case 'p':
+            prefillPercent = atoi(optarg);
+            break;
+        case 'b':
+            workload.batch = atoi(optarg);
+            break;
+        case 'e':
+            engineName = optarg;
+            break;
+        case 'H':
+            hashName = optarg;
+            break;
+        case 's':
+            stripeOption = atoi(optarg);
+            break;
+        case 'S':
+            workload.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'x':
+            workload.timed = 0;
+            break;
+        default:
+            printBenchUsage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if (maxLength < minLength) {
+        maxLength = minLength;
+    }
+
+    chashOptions options;
+    chashDefaultOptions(&options);
+    options.engine = strcmp(engineName, "flat") == 0 ? CHASH_ENGINE_FLAT : CHASH_ENGINE_CHAINED;
+    options.hash = hashName;
+    options.stripes = stripeOption;
+    if (threads < 1 || workload.keyCount < 1 || workload.operations < 1 || workload.batch < 1 ||
+        workload.readPercent < 0 || workload.writePercent < 0 || workload.readPercent + workload.writePercent > 100 ||
+        workload.theta < 0.0 || workload.theta >= 1.0 || minLength < 1 || prefillPercent < 0 || prefillPercent > 100 ||
+        stripeOption < 0 || (strcmp(engineName, "chained") != 0 && strcmp(engineName, "flat") != 0)) {
+        printBenchUsage(argv[0]);
+        return 1;
+    }
+
+    // The Zipfian constants depend only on the key count and theta
+    if (workload.theta > 0.0) {
+        for (int i = 1; i <= workload.keyCount; i++) {
+            workload.zetaN += 1.0 / pow(i, workload.theta);
+        }
+        double zeta2 = 1.0 + pow(0.5, workload.theta);
+        workload.alpha = 1.0 / (1.0 - workload.theta);
+        workload.eta = (1.0 - pow(2.0 / workload.keyCount, 1.0 - workload.theta)) / (1.0 - zeta2 / workload.zetaN);
+    }
+
+    if (generateKeys(&workload, minLength, maxLength) != 0) {
+        fprintf(stderr, "Error: couldn't allocate memory to benchmark keys.\n");
+        return 1;
+    }
+
+    // The table starts small and grows while it is prefilled, as it would in a service.
+    // An unknown hash name is the only option left for chashCreate() to reject.
+    workload.table = chashCreate(&options);
+    if (workload.table == NULL) {
+        printBenchUsage(argv[0]);
+        return 1;
+    }
+
+    // Load the first keys so reads have something to find
+    long prefill = (long)workload.keyCount * prefillPercent / 100;
+    for (long i = 0; i < prefill; i++) {
+        chashInsert(workload.table, (const uint8_t*)workload.keyData + workload.keyOffsets[i], workload.keyLengths[i], (uint32_t)i);
+    }
+
+    benchThread* workers = (benchThread*)calloc(threads, sizeof(benchThread));
+    if (workers == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to benchmark threads.\n");
+        return 1;
+    }
+    pthread_barrier_init(&workload.start, NULL, threads);
+
+    // Every thread starts on the barrier and runs its share of the operations
+    for (int i = 0; i < threads; i++) {
+        workers[i].workload = &workload;
+        workers[i].index = i;
+        workers[i].operations = workload.operations / threads + (i < workload.operations % threads);
+        if (pthread_create(&workers[i].thread, NULL, benchWorker, &workers[i]) != 0) {
+            fprintf(stderr, "Error: couldn't create benchmark thread %d.\n", i);
+            abort();
+        }
+    }
+
+    uint64_t* histogram = (uint64_t*)calloc(LATENCY_BUCKETS, sizeof(uint64_t));
+    uint64_t calls = 0;
+    uint64_t elapsed = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        calls += workers[i].calls;
+        if (workers[i].elapsedNanos > elapsed) {
+            elapsed = workers[i].elapsedNanos;
+        }
+        for (int bucket = 0; histogram != NULL && bucket < LATENCY_BUCKETS; bucket++) {
+            histogram[bucket] += workers[i].latencies[bucket];
+        }
+    }
+
+    printf("Workload: %d keys of %d-%d bytes, %d%% read / %d%% write / %d%% delete, %s keys",
+        workload.keyCount, minLength, maxLength, workload.readPercent, workload.writePercent,
+        100 - workload.readPercent - workload.writePercent, workload.theta > 0.0 ? "zipfian" : "uniform");
+    if (workload.theta > 0.0) {
+        printf(" (theta %.2f)", workload.theta);
+    }
+    printf(", batch %d\n", workload.batch);
+    // Contention over the whole run, prefill included
+    chashStats* totals = chashCollectStats(workload.table);
+    if (totals != NULL) {
+        printf("Table: %s engine, %s hash, %d stripes, %d threads\n",
+            engineName, hashName != NULL ? hashName : "default", totals->stripeCount, threads);
+    }
+    printf("Throughput: %ld operations in %.3f s, %.0f ops/sec\n",
+        workload.operations, elapsed / 1e9, elapsed > 0 ? workload.operations * 1e9 / elapsed : 0.0);
+
+    if (workload.timed && histogram != NULL) {
+        printf("Latency per call: p50 %" PRIu64 " ns, p99 %" PRIu64 " ns, p999 %" PRIu64 " ns\n",
+            latencyPercentile(histogram, calls, 0.50), latencyPercentile(histogram, calls, 0.99),
+            latencyPercentile(histogram, calls, 0.999));
+    }
+
+    if (totals != NULL) {
+        uint64_t acquisitions = 0;
+        uint64_t failures = 0;
+        for (int i = 0; i < totals->stripeCount; i++) {
+            acquisitions += totals->stripes[i].acquisitions;
+            failures += totals->stripes[i].trylockFailures;
+        }
+        printf("Locks: %" PRIu64 " acquisitions, %.2f%% contended\n",
+            acquisitions, acquisitions > 0 ? 100.0 * failures / acquisitions : 0.0);
+        chashFreeStats(totals);
+    }
+
+    pthread_barrier_destroy(&workload.start);
+    free(histogram);
+    free(workers);
+    chashDestroy(workload.table);
+    free(workload.keyData);
+    free(workload.keyOffsets);
+    free(workload.keyLengths);
+    return 0;
+}
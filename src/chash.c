@@ -7,34 +7,91 @@ Elizabeth Teter
 */
 #include "hash.h"
 
+// Marks old buckets that have been migrated, shared by every table
+hashRecord movedBucket;
+
+// Function that rounds a bucket or lock count up to a power of two.
+// Counts above the largest 32-bit power of two stop at it rather than wrapping to 0.
+uint32_t nextPowerOfTwo(uint32_t n) {
+	uint32_t power = 1;
+	while (power < n && power < (1u << 31))
+		power <<= 1;
+	return power;
+}
+
 // Function that creates the hash table.
-hashRecord** createTable() {
+bucketHead* createTable(chashTable* table) {
 
-	concurrentHashTable = (hashRecord**)malloc(tableSize * sizeof(hashRecord*));
+	table->concurrentHashTable = (bucketHead*)calloc(table->tableSize, sizeof(bucketHead));
 
-	if (!concurrentHashTable) {
+	if (!table->concurrentHashTable) {
 		printf("\nError: couldn't allocate memory to hash table.");
 		return NULL;
 	}
 
-	for (int i = 0; i < tableSize; i++)
-		concurrentHashTable[i] = NULL;
+	return table->concurrentHashTable;
+}
+
+// Function that publishes the current bucket arrays to lock-free readers.
+// Called at startup and with every stripe held while a resize starts or finishes.
+void publishView(chashTable* table) {
+	tableView* view = (tableView*)malloc(sizeof(tableView));
+
+	if (view == NULL) {
+		fprintf(stderr, "Error: couldn't allocate memory to table view.\n");
+		abort();
+	}
+
+	view->buckets = table->concurrentHashTable;
+	view->size = table->tableSize;
+	view->oldBuckets = table->oldHashTable;
+	view->oldSize = table->oldTableSize;
 
-	return concurrentHashTable;
+	// Readers that loaded the previous view may still be using it
+	tableView* previous = atomic_exchange(&table->readView, view);
+	if (previous != NULL) {
+		epochRetire(table->epoch, previous, freeRetired);
+	}
 }
 
-// Function to get a current timestamp in seconds.
-time_t currentTimestamp() {
-	time_t seconds;
-	seconds = time(NULL);
-	return seconds;
+// Function to get a current timestamp in nanoseconds.
+// The monotonic clock is read through the vDSO, so this costs no system call.
+uint64_t currentTimestamp() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// Function that traces an operation on a key, with the value it carries when it has one.
+// Integer keys are written out in decimal. Nothing is formatted while tracing is off.
+void traceOperation(const chashTable* table, uint64_t timestamp, const char* operation, uint32_t hashValue,
+                    const uint8_t* key, size_t keyLength, int hasValue, uint32_t value) {
+	if (!logTraceEnabled())
+		return;
+
+	char digits[TRACE_KEY_DIGITS];
+	const char* text = (const char*)key;
+	int length = (int)keyLength;
+	if (table->integerKeys && keyLength == sizeof(uint64_t)) {
+		uint64_t integer;
+		memcpy(&integer, key, sizeof(integer));
+		length = snprintf(digits, sizeof(digits), "%" PRIu64, integer);
+		text = digits;
+	}
+
+	if (hasValue) {
+		logTrace("%" PRIu64 ": %s,%u,%.*s,%u\n", timestamp, operation, hashValue, length, text, value);
+	}
+	else {
+		logTrace("%" PRIu64 ": %s,%u,%.*s\n", timestamp, operation, hashValue, length, text);
+	}
 }
 
 // Function that creates a node.
-hashRecord* createNode(uint8_t* key, uint32_t value, uint32_t hashValue) {
+hashRecord* createNode(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t value, uint32_t hashValue) {
 
 
-	hashRecord* node = (hashRecord*)malloc(sizeof(hashRecord));
+	hashRecord* node = (hashRecord*)slabAlloc(table->recordPool);
 
 
 	if (node == NULL) {
@@ -42,129 +99,399 @@ hashRecord* createNode(uint8_t* key, uint32_t value, uint32_t hashValue) {
 		return NULL;
 	}
 
+	// Short keys are copied inline, long ones into the key arena
+	if (keyInit(&node->key, table->keyStorage, key, keyLength) != 0) {
+		printf("\nError: couldn't allocate memory to key.");
+		slabRelease(table->recordPool, node);
+		return NULL;
+	}
+
 	node->hash = hashValue;
-	strcpy(node->name, (const char*)key);
 	node->salary = value;
 	node->next = NULL;
 
 	return node;
 }
 
-// Hash function.
-uint32_t jenkinsOneAtATime(uint8_t* key, size_t length) {
-	size_t i = 0;
-	uint32_t hash = 0;
-	while (i != length) {
-		hash += key[i++];
-		hash += hash << 10;
-		hash ^= hash >> 6;
-	}
-	hash += hash << 3;
-	hash ^= hash >> 11;
-	hash += hash << 15;
-	return hash;
+// Function that returns the lock stripe guarding a hash value.
+// Lock counts never exceed the bucket count and both are powers of two, so the
+// old and new bucket of a key always sit behind the same stripe during a resize.
+int stripeIndex(chashTable* table, uint32_t hashValue) {
+    return hashValue & (table->lockCount - 1);
 }
 
-// Function that inserts into the hash table.
-void insert(uint8_t* key, uint32_t value) {
+// Function that marks a stripe as being written. The caller holds its write lock.
+// The version is odd while a write is in progress, so snapshot readers know to retry.
+void beginStripeWrite(chashTable* table, int stripe) {
+    unsigned version = atomic_load_explicit(&table->stripe_locks[stripe].version, memory_order_relaxed);
+    atomic_store_explicit(&table->stripe_locks[stripe].version, version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
 
-    // Get the current timestamp
-    time_t timestamp = currentTimestamp();
-    int keyLen = strlen((char*)key);
+// Function that marks the end of a write to a stripe, before its write lock is released.
+void endStripeWrite(chashTable* table, int stripe) {
+    unsigned version = atomic_load_explicit(&table->stripe_locks[stripe].version, memory_order_relaxed);
+    atomic_store_explicit(&table->stripe_locks[stripe].version, version + 1, memory_order_release);
+}
+
+// Function that takes every stripe lock, used to swap the bucket arrays.
+void lockAllStripes(chashTable* table) {
+    for (int i = 0; i < table->lockCount; i++) {
+        pthread_rwlock_wrlock(&table->stripe_locks[i].lock);
+        beginStripeWrite(table, i);
+    }
+}
 
-    // Compute the hash value of the key using the Jenkins one-at-a-time hash function
-    uint32_t hashValue = jenkinsOneAtATime(key, keyLen);
+// Function that releases every stripe lock.
+void unlockAllStripes(chashTable* table) {
+    for (int i = table->lockCount - 1; i >= 0; i--) {
+        endStripeWrite(table, i);
+        pthread_rwlock_unlock(&table->stripe_locks[i].lock);
+    }
+}
 
-    // Compute the index in the hash table
-    int index = hashValue % tableSize;
+// Function that takes a stripe's write lock and records how long it waited.
+// Returns the time the lock was acquired.
+uint64_t lockStripe(chashTable* table, int stripe) {
+    uint64_t start = currentTimestamp();
 
-    // Acquire the write lock to ensure exclusive access for writing
-    pthread_mutex_lock(&write_locks[index]);
-    timestamp = currentTimestamp();
-    lockAcquisitions++;
-    fprintf(output, "%ld: WRITE LOCK ACQUIRED\n", timestamp);
+    // A failed trylock is what counts as contention
+    int contended = pthread_rwlock_trywrlock(&table->stripe_locks[stripe].lock) != 0;
+    if (contended) {
+        pthread_rwlock_wrlock(&table->stripe_locks[stripe].lock);
+    }
 
-    // Print the insert operation to the output file
-    fprintf(output, "%ld: INSERT,%u,%s,%u\n", timestamp, hashValue, key, value);
-    
+    beginStripeWrite(table, stripe);
 
-    // Check if there is an existing entry in the hash table at the computed index
-    if (concurrentHashTable[index] != NULL) {
-        hashRecord* current = concurrentHashTable[index];
+    uint64_t acquired = currentTimestamp();
+    statsLockAcquired(table->stats, stripe, acquired - start, contended);
+    return acquired;
+}
 
-        // Traverse the linked list to find the node with the same hash and key
-        while (current->next && (current->hash != hashValue || strncmp((char*)current->name, (char*)key, MAX_LINE_LENGTH) != 0)) {
-            current = current->next;
-        }
+// Function that releases a stripe's write lock and records how long it was held.
+// Returns the time the lock was released.
+uint64_t unlockStripe(chashTable* table, int stripe, uint64_t acquired) {
+    endStripeWrite(table, stripe);
+    pthread_rwlock_unlock(&table->stripe_locks[stripe].lock);
 
-        // If the node with the same hash and key is found, update its salary
-        if (current->hash == hashValue && strncmp((char*)current->name, (char*)key, MAX_LINE_LENGTH) == 0) {
-            current->salary = value;
-
-            // Release the write lock and return as the value is updated
-            pthread_mutex_unlock(&write_locks[index]);
-            timestamp = currentTimestamp();
-            fprintf(output, "%ld: WRITE LOCK RELEASED\n", timestamp);
-            lockReleases++;
+    uint64_t released = currentTimestamp();
+    statsLockReleased(table->stats, stripe, released - acquired);
+    return released;
+}
+
+// Function that takes a stripe's read lock and records how long it waited.
+uint64_t readLockStripe(chashTable* table, int stripe) {
+    uint64_t start = currentTimestamp();
+
+    int contended = pthread_rwlock_tryrdlock(&table->stripe_locks[stripe].lock) != 0;
+    if (contended) {
+        pthread_rwlock_rdlock(&table->stripe_locks[stripe].lock);
+    }
+
+    uint64_t acquired = currentTimestamp();
+    statsLockAcquired(table->stats, stripe, acquired - start, contended);
+    return acquired;
+}
+
+// Function that releases a stripe's read lock and records how long it was held.
+uint64_t readUnlockStripe(chashTable* table, int stripe, uint64_t acquired) {
+    pthread_rwlock_unlock(&table->stripe_locks[stripe].lock);
+
+    uint64_t released = currentTimestamp();
+    statsLockReleased(table->stats, stripe, released - acquired);
+    return released;
+}
+
+// Function that frees a node once it has been retired. Context is the node's table.
+void freeRecord(void* context, void* pointer) {
+    chashTable* table = (chashTable*)context;
+    keyRelease(&((hashRecord*)pointer)->key, table->keyStorage);
+    slabRelease(table->recordPool, pointer);
+}
+
+// Function that frees a retired view or bucket array.
+void freeRetired(void* context, void* pointer) {
+    (void)context;
+    free(pointer);
+}
+
+// Function that moves the chain of one old bucket into the current table.
+// The caller holds the write lock of the bucket's stripe.
+void migrateBucket(chashTable* table, uint32_t oldIndex) {
+    hashRecord* chain = atomic_load_explicit(&table->oldHashTable[oldIndex], memory_order_relaxed);
+    if (chain == MOVED) {
+        return;
+    }
+
+    // Lock-free readers may still be walking the old chain, so it is copied rather than relinked
+    hashRecord* copies = NULL;
+    for (hashRecord* current = chain; current != NULL; current = current->next) {
+        hashRecord* copy = createNode(table, (const uint8_t*)keyData(&current->key), current->key.length, current->salary, current->hash);
+
+        // Out of memory: relink instead, readers may briefly miss a key but never touch freed memory
+        if (copy == NULL) {
+            while (copies != NULL) {
+                hashRecord* next = copies->next;
+                freeRecord(table, copies);
+                copies = next;
+            }
+            for (hashRecord* node = chain; node != NULL;) {
+                hashRecord* next = node->next;
+                uint32_t index = node->hash & (table->tableSize - 1);
+                atomic_store_explicit(&node->next, table->concurrentHashTable[index], memory_order_relaxed);
+                atomic_store_explicit(&table->concurrentHashTable[index], node, memory_order_release);
+                node = next;
+            }
+            atomic_store_explicit(&table->oldHashTable[oldIndex], MOVED, memory_order_release);
             return;
         }
+
+        copy->next = copies;
+        copies = copy;
     }
 
-    // If the node is not found, create a new node and insert it into the hash table
-    hashRecord* node = createNode(key, value, hashValue);
+    // Publish each copy at the head of its new bucket
+    while (copies != NULL) {
+        hashRecord* next = copies->next;
+        uint32_t index = copies->hash & (table->tableSize - 1);
+        atomic_store_explicit(&copies->next, table->concurrentHashTable[index], memory_order_relaxed);
+        atomic_store_explicit(&table->concurrentHashTable[index], copies, memory_order_release);
+        copies = next;
+    }
 
-    // Check if memory allocation for the new node failed
-    if (node == NULL) {
-        fprintf(stderr, "Memory allocation failed\n");
+    // Send readers to the new bucket, then retire the old chain
+    atomic_store_explicit(&table->oldHashTable[oldIndex], MOVED, memory_order_release);
+    while (chain != NULL) {
+        hashRecord* next = chain->next;
+        epochRetire(table->epoch, chain, freeRecord);
+        chain = next;
+    }
+}
 
-        // Release the write lock in case of failure
-        pthread_mutex_unlock(&write_locks[index]);
-        timestamp = currentTimestamp();
-        fprintf(output, "%ld: WRITE LOCK RELEASED\n", timestamp);
-        lockReleases++;
+// Function that doubles the bucket array once the load factor is exceeded.
+// Only the empty array is allocated here; the chains move over in rehashStep().
+void startResize(chashTable* table) {
+    // Another thread is already starting or finishing a resize
+    if (pthread_mutex_trylock(&table->resizeLock) != 0) {
         return;
     }
 
-    // Insert the new node at the beginning of the linked list at the computed index
-    node->next = concurrentHashTable[index];
-    concurrentHashTable[index] = node;
+    // The resize fields only change under resizeLock, so a resize already under way or a threshold
+    // another thread has moved is seen here without stopping every writer on the stripe locks
+    if (table->oldHashTable != NULL ||
+        atomic_load(&table->entryCount) <= atomic_load(&table->resizeThreshold)) {
+        pthread_mutex_unlock(&table->resizeLock);
+        return;
+    }
+
+    // At the largest bucket array the chains just grow, so inserts stop asking
+    if (table->tableSize >= CHASH_MAX_CAPACITY) {
+        atomic_store(&table->resizeThreshold, UINT32_MAX);
+        pthread_mutex_unlock(&table->resizeLock);
+        return;
+    }
+
+    // Allocate before stopping the writers, they only need to wait for the swap
+    bucketHead* buckets = (bucketHead*)calloc((size_t)table->tableSize * 2, sizeof(bucketHead));
+    if (buckets == NULL) {
+        // Back off until the table has doubled again rather than retrying on every insert
+        uint32_t threshold = atomic_load(&table->resizeThreshold);
+        atomic_store(&table->resizeThreshold, threshold > UINT32_MAX / 2 ? UINT32_MAX : threshold * 2);
+        fprintf(stderr, "Error: couldn't allocate memory to grow the hash table.\n");
+        pthread_mutex_unlock(&table->resizeLock);
+        return;
+    }
+
+    lockAllStripes(table);
+
+    table->oldHashTable = table->concurrentHashTable;
+    table->oldTableSize = table->tableSize;
+    table->concurrentHashTable = buckets;
+    table->tableSize *= 2;
+    table->resizeGeneration++;
+    atomic_store(&table->rehashedBuckets, 0);
+    atomic_store(&table->rehashCursor, (uint64_t)table->resizeGeneration << 32);
+    atomic_store(&table->resizeThreshold, (uint32_t)table->tableSize * MAX_LOAD_FACTOR);
+    atomic_store(&table->resizing, 1);
+    publishView(table);
+
+    unlockAllStripes(table);
+    pthread_mutex_unlock(&table->resizeLock);
+}
+
+// Function that frees the old bucket array once every chain has moved.
+void finishResize(chashTable* table) {
+    pthread_mutex_lock(&table->resizeLock);
+    lockAllStripes(table);
+
+    // Readers holding an older view may still look at the old array
+    epochRetire(table->epoch, table->oldHashTable, freeRetired);
+    table->oldHashTable = NULL;
+    table->oldTableSize = 0;
+    atomic_store(&table->resizing, 0);
+    publishView(table);
+
+    unlockAllStripes(table);
+    pthread_mutex_unlock(&table->resizeLock);
+}
+
+// Function that migrates a few old buckets on behalf of a resize in progress.
+// Called by writers after releasing their own lock, so no call copies the whole table.
+void rehashStep(chashTable* table) {
+    int finished = 0;
+
+    for (int step = 0; step < REHASH_STEP && atomic_load(&table->resizing); step++) {
+        // Claims are tagged with the resize generation so a late claim never counts twice
+        uint64_t claim = atomic_fetch_add(&table->rehashCursor, 1);
+        uint32_t generation = (uint32_t)(claim >> 32);
+        uint32_t oldIndex = (uint32_t)claim;
+
+        // Claims past the end are harmless, the array was covered by earlier ones
+        int stripe = oldIndex & (table->lockCount - 1);
+        pthread_rwlock_wrlock(&table->stripe_locks[stripe].lock);
+        beginStripeWrite(table, stripe);
+        int valid = table->oldHashTable != NULL && generation == table->resizeGeneration && oldIndex < table->oldTableSize;
+        if (valid) {
+            migrateBucket(table, oldIndex);
+            finished = atomic_fetch_add(&table->rehashedBuckets, 1) + 1 == table->oldTableSize;
+        }
+        endStripeWrite(table, stripe);
+        pthread_rwlock_unlock(&table->stripe_locks[stripe].lock);
+
+        if (!valid || finished) {
+            break;
+        }
+    }
+
+    if (finished) {
+        finishResize(table);
+    }
+}
 
-    // Release the write lock after inserting the new node
-    pthread_mutex_unlock(&write_locks[index]);
-    timestamp = currentTimestamp();
-    fprintf(output, "%ld: WRITE LOCK RELEASED\n", timestamp);
-    lockReleases++;
+// Function that returns a key's bucket in the current array, bringing its old bucket over first if a resize is in progress.
+// The caller holds the write lock of the key's stripe.
+uint32_t writeBucket(chashTable* table, uint32_t hashValue) {
+    if (table->oldHashTable != NULL) {
+        migrateBucket(table, hashValue & (table->oldTableSize - 1));
+    }
+    return hashValue & (table->tableSize - 1);
 }
 
-// Function that deletes from the hash table.
-void delete(uint8_t* key) {
-    // Calculate the key length
-    int keyLen = strlen((char*)key);
+// Function that counts the keys a write added and grows the table once the average chain is longer than the load factor.
+// Called after the stripe lock is released, it also moves a few buckets of a resize in progress.
+void afterInsert(chashTable* table, uint32_t added) {
+    if (added > 0 && atomic_fetch_add(&table->entryCount, added) + added > atomic_load(&table->resizeThreshold)) {
+        startResize(table);
+    }
+    rehashStep(table);
+}
+
+// Function that inserts into the hash table.
+void chashInsert(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t value) {
+    chashInsertHashed(table, key, keyLength, table->keyHash(key, keyLength), value);
+}
 
-    // Compute the hash value of the key using the Jenkins one-at-a-time hash function
-    uint32_t hashValue = jenkinsOneAtATime(key, keyLen);
+// Function that inserts a key while its stripe's write lock is held.
+// A chained node that gets linked in is taken from the caller, who frees it otherwise.
+// Returns 1 when the key was new to the chained table.
+int insertLocked(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t value, hashRecord** node) {
+    // The flat engine stores entries inline, the stripe's write lock already keeps readers out
+    if (table->tableEngine == ENGINE_FLAT) {
+        flatInsert(table->flatHashTable, key, keyLength, hashValue, value);
+        return 0;
+    }
 
     // Compute the index in the hash table
-    int index = hashValue % tableSize;
+    uint32_t index = writeBucket(table, hashValue);
 
-    // Get the current timestamp
-    time_t timestamp = time(NULL);
+    // Check if there is an existing entry in the hash table at the computed index
+    if (table->concurrentHashTable[index] != NULL) {
+        hashRecord* current = table->concurrentHashTable[index];
+
+        // Traverse the linked list to find the node with the same hash and key
+        while (current->next && (current->hash != hashValue || !keyEquals(&current->key, key, keyLength))) {
+            current = current->next;
+        }
+
+        // If the node with the same hash and key is found, update its salary
+        if (current->hash == hashValue && keyEquals(&current->key, key, keyLength)) {
+            atomic_store_explicit(&current->salary, value, memory_order_relaxed);
+            return 0;
+        }
+    }
+
+    // Insert the new node at the beginning of the linked list at the computed index,
+    // publishing it only once it is fully initialized
+    atomic_store_explicit(&(*node)->next, table->concurrentHashTable[index], memory_order_relaxed);
+    atomic_store_explicit(&table->concurrentHashTable[index], *node, memory_order_release);
+    *node = NULL;
+    return 1;
+}
+
+// Function that inserts a key whose hash is already known into the hash table.
+void chashInsertHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t value) {
+    statsCountOperation(table->stats, STAT_INSERT);
+
+    // Compute the lock stripe guarding the key
+    int stripe = stripeIndex(table, hashValue);
+
+    // Allocate the chained node before taking the lock, it goes back to the slab if the key exists
+    hashRecord* node = NULL;
+    if (table->tableEngine == ENGINE_CHAINED) {
+        node = createNode(table, key, keyLength, value, hashValue);
+
+        // Check if memory allocation for the new node failed
+        if (node == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return;
+        }
+    }
 
     // Acquire the write lock to ensure exclusive access for writing
-    pthread_mutex_lock(&write_locks[index]);
-    lockAcquisitions++;
-    fprintf(output, "%ld: WRITE LOCK ACQUIRED\n", timestamp);
+    uint64_t acquired = lockStripe(table, stripe);
+    uint64_t timestamp = acquired;
+    logTrace("%" PRIu64 ": WRITE LOCK ACQUIRED\n", timestamp);
 
-    // Print the delete operation to the output file
-    fprintf(output, "%ld: DELETE,%u,%s\n", timestamp, hashValue, key);
-    
+    // Print the insert operation to the output file
+    traceOperation(table, timestamp, "INSERT", hashValue, key, keyLength, 1, value);
+
+    int added = insertLocked(table, key, keyLength, hashValue, value, &node);
+
+    // Release the write lock after inserting or updating
+    timestamp = unlockStripe(table, stripe, acquired);
+    logTrace("%" PRIu64 ": WRITE LOCK RELEASED\n", timestamp);
+
+    if (table->tableEngine == ENGINE_FLAT) {
+        return;
+    }
+    if (node != NULL) {
+        freeRecord(table, node);
+    }
+
+    afterInsert(table, added);
+}
+
+// Function that deletes from the hash table. Returns 1 when the key was present.
+int chashDelete(chashTable* table, const uint8_t* key, size_t keyLength) {
+    return chashDeleteHashed(table, key, keyLength, table->keyHash(key, keyLength));
+}
+
+// Function that deletes a key while its stripe's write lock is held. Returns 1 when the key was present.
+int deleteLocked(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue) {
+    // The flat engine stores entries inline, the stripe's write lock already keeps readers out
+    if (table->tableEngine == ENGINE_FLAT) {
+        return flatDelete(table->flatHashTable, key, keyLength, hashValue);
+    }
+
+    // Compute the index in the hash table
+    uint32_t index = writeBucket(table, hashValue);
 
     // Pointer to traverse the linked list at hashTable[index]
-    hashRecord* current = concurrentHashTable[index];
+    hashRecord* current = table->concurrentHashTable[index];
     hashRecord* previous = NULL;
 
     // Traverse the list to find the node to delete
-    while (current != NULL && (current->hash != hashValue || strncmp((char*)current->name, (char*)key, MAX_LINE_LENGTH) != 0)) {
+    while (current != NULL && (current->hash != hashValue || !keyEquals(&current->key, key, keyLength))) {
         previous = current;
         current = current->next;
     }
@@ -173,272 +500,951 @@ void delete(uint8_t* key) {
     if (current != NULL) {
         if (previous == NULL) {
             // Node to delete is the first node in the list
-            concurrentHashTable[index] = current->next;
+            atomic_store_explicit(&table->concurrentHashTable[index], current->next, memory_order_release);
         } else {
             // Node to delete is in the middle or end of the list
-            previous->next = current->next;
+            atomic_store_explicit(&previous->next, current->next, memory_order_release);
         }
 
-        free(current);  // Free the memory of the deleted node
+        // Lock-free readers may still be on the node, so freeing it is deferred
+        epochRetire(table->epoch, current, freeRecord);
+        atomic_fetch_sub(&table->entryCount, 1);
     }
+    return current != NULL;
+}
 
-    // Get the current timestamp
-    timestamp = time(NULL);
+// Function that deletes a key whose hash is already known from the hash table.
+// Returns 1 when the key was present.
+int chashDeleteHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue) {
+    statsCountOperation(table->stats, STAT_DELETE);
+
+    // Compute the lock stripe guarding the key
+    int stripe = stripeIndex(table, hashValue);
+
+    // Acquire the write lock to ensure exclusive access for writing
+    uint64_t acquired = lockStripe(table, stripe);
+    uint64_t timestamp = acquired;
+    logTrace("%" PRIu64 ": WRITE LOCK ACQUIRED\n", timestamp);
+
+    // Print the delete operation to the output file
+    traceOperation(table, timestamp, "DELETE", hashValue, key, keyLength, 0, 0);
+
+    int found = deleteLocked(table, key, keyLength, hashValue);
 
     // Release the write lock after deletion
-    fprintf(output, "%ld: WRITE LOCK RELEASED\n", timestamp);
-    lockReleases++;
-    pthread_mutex_unlock(&write_locks[index]);
+    timestamp = unlockStripe(table, stripe, acquired);
+    logTrace("%" PRIu64 ": WRITE LOCK RELEASED\n", timestamp);
+    if (table->tableEngine == ENGINE_CHAINED) {
+        rehashStep(table);
+    }
+    return found;
 }
 
-// Function that searches in the hash table.
-uint32_t search(uint8_t* key) {
-    // Get the current timestamp
-    time_t timestamp = currentTimestamp();
+// Function that walks one chain looking for a key.
+hashRecord* findInChain(hashRecord* current, const uint8_t* key, size_t keyLength, uint32_t hashValue) {
+    while (current != NULL) {
+        if (current->hash == hashValue && keyEquals(&current->key, key, keyLength)) {
+            return current;
+        }
+        current = atomic_load_explicit(&current->next, memory_order_acquire);
+    }
+    return NULL;
+}
 
-    // Calculate the key length
-    int keyLen = strlen((char*)key);
+// Function that finds a key without taking any lock. The caller is inside an epoch.
+hashRecord* lockFreeFind(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue) {
+    for (;;) {
+        tableView* view = atomic_load_explicit(&table->readView, memory_order_acquire);
+        hashRecord* head;
+
+        // A bucket that hasn't been migrated yet still lives in the old array
+        if (view->oldBuckets != NULL) {
+            head = atomic_load_explicit(&view->oldBuckets[hashValue & (view->oldSize - 1)], memory_order_acquire);
+            if (head != MOVED) {
+                return findInChain(head, key, keyLength, hashValue);
+            }
+        }
 
-    // Compute the hash value of the key using the Jenkins one-at-a-time hash function
-    uint32_t hashValue = jenkinsOneAtATime(key, keyLen);
+        // A resize that started after the view was loaded has moved this bucket on
+        head = atomic_load_explicit(&view->buckets[hashValue & (view->size - 1)], memory_order_acquire);
+        if (head != MOVED) {
+            return findInChain(head, key, keyLength, hashValue);
+        }
+    }
+}
 
-    // Compute the index in the hash table
-    int index = hashValue % tableSize;
+// Function that searches the hash table. Returns 1 and stores its salary when the key is present,
+// so a missing key can be told from a salary of 0.
+int chashSearch(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t* salary) {
+    return chashSearchHashed(table, key, keyLength, table->keyHash(key, keyLength), salary);
+}
 
-    // Log the read lock acquisition and search operation
-    fprintf(output, "%ld: READ LOCK ACQUIRED\n", timestamp);
-    fprintf(output, "%ld: SEARCH,%u,%s\n", timestamp, hashValue, key);
+// Function that looks up a key whose hash is already known.
+// Returns 1 and stores its salary when the key is present.
+int chashSearchHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t* salary) {
+    statsCountOperation(table->stats, STAT_SEARCH);
 
-    // Acquire read lock for concurrent access
-    pthread_rwlock_rdlock(&read_locks[index]);
-    lockAcquisitions++;
+    // Get the current timestamp
+    uint64_t timestamp = currentTimestamp();
 
-    // Pointer to traverse the linked list at hashTable[index]
-    hashRecord* current = concurrentHashTable[index];
+    int found;
 
-    // Traverse the list to find the node with the matching hash and key
-    while (current != NULL) {
-        if (current->hash == hashValue && strncmp((char*)current->name, (char*)key, MAX_LINE_LENGTH) == 0) {
-            uint32_t salary = current->salary;
+    // Chains are read without any lock, deleted nodes stay valid until the epoch moves on
+    if (table->tableEngine == ENGINE_CHAINED) {
+        traceOperation(table, timestamp, "SEARCH", hashValue, key, keyLength, 0, 0);
 
-            // Release read lock after reading
-            pthread_rwlock_unlock(&read_locks[index]);
-            lockReleases++;
-            return salary;
+        epochEnter(table->epoch);
+        hashRecord* record = lockFreeFind(table, key, keyLength, hashValue);
+        found = record != NULL;
+        if (found) {
+            *salary = atomic_load_explicit(&record->salary, memory_order_relaxed);
         }
-        current = current->next;
+        epochExit(table->epoch);
+
+        return found;
     }
 
+    // Compute the lock stripe guarding the key
+    int stripe = stripeIndex(table, hashValue);
+
+    // Acquire read lock for concurrent access
+    uint64_t acquired = readLockStripe(table, stripe);
+    timestamp = acquired;
+
+    // Log the read lock acquisition and search operation
+    logTrace("%" PRIu64 ": READ LOCK ACQUIRED\n", timestamp);
+    traceOperation(table, timestamp, "SEARCH", hashValue, key, keyLength, 0, 0);
+
+    found = flatSearch(table->flatHashTable, key, keyLength, hashValue, salary);
+
     // Release read lock after reading
-    pthread_rwlock_unlock(&read_locks[index]);
-    timestamp = currentTimestamp();
-    lockReleases++;
+    timestamp = readUnlockStripe(table, stripe, acquired);
+    logTrace("%" PRIu64 ": READ LOCK RELEASED\n", timestamp);
 
-    // Key not found, return 0
-    return 0;
+    return found;
 }
 
-// Helper function for qsort to compare hash values of two hashRecord structs
-int compareHashRecords(const void* a, const void* b) {
-	hashRecord* recordA = *(hashRecord**)a;
-	hashRecord* recordB = *(hashRecord**)b;
-	return (recordA->hash - recordB->hash);
+// Function that returns a key's salary after an update, given the salary it had.
+uint32_t updatedSalary(int update, uint32_t current, uint32_t operand, uint32_t expected) {
+    if (update == UPDATE_COMPARE_AND_SWAP) {
+        return current == expected ? operand : current;
+    }
+    if (update == UPDATE_FETCH_ADD) {
+        return current + operand;
+    }
+    return current;
 }
 
-// Function that print the whole hashtable.
-void printTable() {
-    // Get the current timestamp
-    time_t timestamp = time(NULL);    
-
-    // Log the read lock acquisition
-    pthread_rwlock_rdlock(&read_locks[0]);
-    fprintf(output, "%ld: READ LOCK ACQUIRED\n", timestamp);
-    lockAcquisitions++;
-
-    // Step 1: Gather all entries into a list
-    // Allocate a dynamic list to store hash records
-    hashRecord** records = malloc(tableSize * sizeof(hashRecord*));
-    int count = 0;
-
-    // Traverse the hash table and gather all entries
-    for (int i = 0; i < tableSize; i++) {
-        hashRecord* current = concurrentHashTable[i];
-        while (current != NULL) {
-            records[count++] = current;
-            current = current->next;
+// Function that reads and updates a key's salary under a single write lock, so nothing can
+// come between the read and the write. A missing key is inserted with the operand, except by
+// compare-and-swap which leaves it missing.
+// Returns 1 and stores the salary from before the update in previous when the key was present.
+int updateSalary(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, int update, uint32_t operand, uint32_t expected, uint32_t* previous) {
+    static const char* const updateNames[] = { "GETORINSERT", "CAS", "ADD" };
+
+    statsCountOperation(table->stats, STAT_UPDATE);
+
+    // Compute the lock stripe guarding the key
+    int stripe = stripeIndex(table, hashValue);
+
+    // Allocate the chained node before taking the lock in case the key is missing
+    hashRecord* node = NULL;
+    if (table->tableEngine == ENGINE_CHAINED && update != UPDATE_COMPARE_AND_SWAP) {
+        node = createNode(table, key, keyLength, operand, hashValue);
+
+        // Check if memory allocation for the new node failed
+        if (node == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return 0;
+        }
+    }
+
+    // Acquire the write lock to ensure exclusive access for writing
+    uint64_t acquired = lockStripe(table, stripe);
+    uint64_t timestamp = acquired;
+    logTrace("%" PRIu64 ": WRITE LOCK ACQUIRED\n", timestamp);
+    traceOperation(table, timestamp, updateNames[update], hashValue, key, keyLength, 1, operand);
+
+    uint32_t current = 0;
+    int found;
+    int added = 0;
+
+    if (table->tableEngine == ENGINE_FLAT) {
+        uint32_t* salary = flatValue(table->flatHashTable, key, keyLength, hashValue);
+        found = salary != NULL;
+        if (found) {
+            current = *salary;
+            *salary = updatedSalary(update, current, operand, expected);
+        }
+        else if (update != UPDATE_COMPARE_AND_SWAP) {
+            flatInsert(table->flatHashTable, key, keyLength, hashValue, operand);
+        }
+    }
+    else {
+        uint32_t index = writeBucket(table, hashValue);
+        hashRecord* record = findInChain(table->concurrentHashTable[index], key, keyLength, hashValue);
+        found = record != NULL;
+
+        // Lock-free readers only ever see the salary before or after the update
+        if (found) {
+            current = atomic_load_explicit(&record->salary, memory_order_relaxed);
+            atomic_store_explicit(&record->salary, updatedSalary(update, current, operand, expected), memory_order_relaxed);
         }
+        else if (node != NULL) {
+            atomic_store_explicit(&node->next, table->concurrentHashTable[index], memory_order_relaxed);
+            atomic_store_explicit(&table->concurrentHashTable[index], node, memory_order_release);
+            node = NULL;
+            added = 1;
+        }
+    }
+
+    // Release the write lock after the update
+    timestamp = unlockStripe(table, stripe, acquired);
+    logTrace("%" PRIu64 ": WRITE LOCK RELEASED\n", timestamp);
+
+    if (table->tableEngine == ENGINE_CHAINED) {
+        if (node != NULL) {
+            freeRecord(table, node);
+        }
+
+        afterInsert(table, added);
+    }
+
+    if (found && previous != NULL) {
+        *previous = current;
+    }
+    return found;
+}
+
+// Function that returns a key's salary, inserting the key with the given salary if it is missing.
+// Returns 1 and stores the salary it already had in existing when the key was present.
+int chashGetOrInsert(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t value, uint32_t* existing) {
+    return chashGetOrInsertHashed(table, key, keyLength, table->keyHash(key, keyLength), value, existing);
+}
+
+// Function that gets or inserts a key whose hash is already known.
+int chashGetOrInsertHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t value, uint32_t* existing) {
+    return updateSalary(table, key, keyLength, hashValue, UPDATE_GET_OR_INSERT, value, 0, existing);
+}
+
+// Function that replaces a key's salary only if it still equals expected.
+// Returns 1 when it was replaced, 0 when it differed, with the salary seen stored in current,
+// and -1 when the key is missing.
+int chashCompareAndSwap(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t expected, uint32_t desired, uint32_t* current) {
+    return chashCompareAndSwapHashed(table, key, keyLength, table->keyHash(key, keyLength), expected, desired, current);
+}
+
+// Function that compares and swaps the salary of a key whose hash is already known.
+int chashCompareAndSwapHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t expected, uint32_t desired, uint32_t* current) {
+    uint32_t seen = 0;
+    if (!updateSalary(table, key, keyLength, hashValue, UPDATE_COMPARE_AND_SWAP, desired, expected, &seen)) {
+        return -1;
     }
 
-    // Step 2: Sort the list by hash values
-    qsort(records, count, sizeof(hashRecord*), compareHashRecords);
+    if (current != NULL) {
+        *current = seen;
+    }
+    return seen == expected;
+}
+
+// Function that adds to a key's salary, inserting the key with delta as its salary if it is missing.
+// Salaries wrap around like any unsigned value. Returns the salary from before the add, 0 for a new key.
+uint32_t chashFetchAdd(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t delta) {
+    return chashFetchAddHashed(table, key, keyLength, table->keyHash(key, keyLength), delta);
+}
+
+// Function that adds to the salary of a key whose hash is already known.
+uint32_t chashFetchAddHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t delta) {
+    uint32_t previous = 0;
+    updateSalary(table, key, keyLength, hashValue, UPDATE_FETCH_ADD, delta, 0, &previous);
+    return previous;
+}
+
+// Function that adds to a key's salary like chashFetchAdd(), returning the salary after the add.
+uint32_t chashAddFetch(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t delta) {
+    return chashFetchAdd(table, key, keyLength, delta) + delta;
+}
+
+// Function that inserts an integer key. It is stored inline as its eight bytes in host order,
+// so it compares as a single word, and is hashed with a single multiply.
+void chashInsertInteger(chashTable* table, uint64_t key, uint32_t value) {
+    chashInsertHashed(table, (const uint8_t*)&key, sizeof(key), chashIntegerHash(key), value);
+}
+
+// Function that deletes an integer key. Returns 1 when the key was present.
+int chashDeleteInteger(chashTable* table, uint64_t key) {
+    return chashDeleteHashed(table, (const uint8_t*)&key, sizeof(key), chashIntegerHash(key));
+}
+
+// Function that searches for an integer key. Returns 1 and stores its salary when the key is present.
+int chashSearchInteger(chashTable* table, uint64_t key, uint32_t* salary) {
+    return chashSearchHashed(table, (const uint8_t*)&key, sizeof(key), chashIntegerHash(key), salary);
+}
+
+// Function that returns an integer key's salary, inserting it if it is missing, like chashGetOrInsert().
+int chashGetOrInsertInteger(chashTable* table, uint64_t key, uint32_t value, uint32_t* existing) {
+    return chashGetOrInsertHashed(table, (const uint8_t*)&key, sizeof(key), chashIntegerHash(key), value, existing);
+}
+
+// Function that swaps an integer key's salary like chashCompareAndSwap().
+int chashCompareAndSwapInteger(chashTable* table, uint64_t key, uint32_t expected, uint32_t desired, uint32_t* current) {
+    return chashCompareAndSwapHashed(table, (const uint8_t*)&key, sizeof(key), chashIntegerHash(key), expected, desired, current);
+}
+
+// Function that adds to the salary of an integer key like chashFetchAdd().
+uint32_t chashFetchAddInteger(chashTable* table, uint64_t key, uint32_t delta) {
+    return chashFetchAddHashed(table, (const uint8_t*)&key, sizeof(key), chashIntegerHash(key), delta);
+}
+
+// Function that hashes a batch of keys, unless their hashes are given, and orders them by
+// lock stripe so each stripe is locked once. The sort is stable, so a key that appears
+// more than once keeps its operations in batch order. Returns -1 if it can't allocate.
+int planBatch(chashTable* table, batchPlan* plan, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, int count) {
+    plan->hashes = (uint32_t*)malloc(count * sizeof(uint32_t));
+    plan->order = (int*)malloc(2 * count * sizeof(int));
+    if (plan->hashes == NULL || plan->order == NULL) {
+        free(plan->hashes);
+        free(plan->order);
+        return -1;
+    }
 
-    // Step 3: Print sorted entries
     for (int i = 0; i < count; i++) {
-        fprintf(output, "%u,%s,%u\n", records[i]->hash, records[i]->name, records[i]->salary);
+        plan->hashes[i] = hashes != NULL ? hashes[i] : table->keyHash(keys[i], keyLengths[i]);
+        plan->order[i] = i;
     }
 
-    // Clean up the temporary list
-    free(records);
+    // LSD radix sort over the stripe bits, eight at a time. A single stripe needs no passes.
+    int* order = plan->order;
+    int* spare = plan->order + count;
+    for (int shift = 0; ((uint32_t)(table->lockCount - 1) >> shift) != 0; shift += 8) {
+        int counts[257] = { 0 };
+        for (int i = 0; i < count; i++) {
+            counts[((stripeIndex(table, plan->hashes[order[i]]) >> shift) & 255) + 1]++;
+        }
+        for (int digit = 0; digit < 256; digit++) {
+            counts[digit + 1] += counts[digit];
+        }
+        for (int i = 0; i < count; i++) {
+            spare[counts[(stripeIndex(table, plan->hashes[order[i]]) >> shift) & 255]++] = order[i];
+        }
 
-    // Get the current timestamp
-    timestamp = time(NULL);
-
-    // Log the read lock release
-    pthread_rwlock_unlock(&read_locks[0]);    
-    lockReleases++;
-    fprintf(output, "%ld: READ LOCK RELEASED\n", timestamp);
-}
-
-// Function that clears the hashtable
-void cleanupHashTable() {
-	for (int i = 0; i < tableSize; i++) {
-		hashRecord* current = concurrentHashTable[i];
-		while (current != NULL) {
-			hashRecord* temp = current;
-			current = current->next;
-			free(temp);
-		}
-	}
+        int* swap = order;
+        order = spare;
+        spare = swap;
+    }
+
+    // The sorted order may have ended up in the second half
+    if (order != plan->order) {
+        memcpy(plan->order, order, count * sizeof(int));
+    }
+    return 0;
+}
+
+// Function that frees a batch plan.
+void freeBatchPlan(batchPlan* plan) {
+    free(plan->hashes);
+    free(plan->order);
+}
+
+// Function that returns the end of the run of planned keys starting at start that share its stripe.
+int batchStripeEnd(chashTable* table, const batchPlan* plan, int start, int count) {
+    int stripe = stripeIndex(table, plan->hashes[plan->order[start]]);
+    int end = start + 1;
+    while (end < count && stripeIndex(table, plan->hashes[plan->order[end]]) == stripe) {
+        end++;
+    }
+    return end;
+}
+
+// Function that pulls a key's bucket into the cache ahead of a write. The caller holds its stripe lock.
+void prefetchBucket(chashTable* table, uint32_t hashValue) {
+    if (table->tableEngine == ENGINE_FLAT) {
+        flatPrefetch(table->flatHashTable, hashValue);
+        return;
+    }
+
+    if (table->oldHashTable != NULL) {
+        __builtin_prefetch(&table->oldHashTable[hashValue & (table->oldTableSize - 1)], 1);
+    }
+    __builtin_prefetch(&table->concurrentHashTable[hashValue & (table->tableSize - 1)], 1);
 }
 
-// Function that reads next line and splits around commas.
-void parseCommand(FILE* commands, char destination[][50]) {
-    int c;
-    int i = 0;
+// Function that inserts a batch of keys, taking each stripe's write lock once for all of its keys.
+// Hashes may be NULL, in which case they are computed here.
+void chashInsertBatch(chashTable* table, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, const uint32_t* values, int count) {
+    batchPlan plan;
+    hashRecord** nodes = NULL;
+
+    if (count <= 0) {
+        return;
+    }
 
-    // Read the first part of the command
-    for (; (c = fgetc(commands)) != ','; i++) {
-        destination[0][i] = c;
+    int planned = planBatch(table, &plan, keys, keyLengths, hashes, count) == 0;
+    if (planned && table->tableEngine == ENGINE_CHAINED) {
+        nodes = (hashRecord**)malloc(count * sizeof(hashRecord*));
+        if (nodes == NULL) {
+            freeBatchPlan(&plan);
+            planned = 0;
+        }
     }
-    destination[0][i] = '\0';
 
-    // If the command is 'print', handle it differently
-    if (strcmp(destination[0], "print") == 0) {
-        strcpy(destination[1], "0");
-        strcpy(destination[2], "0");
-		while ((c = fgetc(commands)) != '\n' && c != EOF);  // Move to the end of the line
+    // Without room to plan the batch, the keys go in one at a time
+    if (!planned) {
+        for (int i = 0; i < count; i++) {
+            chashInsertHashed(table, keys[i], keyLengths[i], hashes != NULL ? hashes[i] : table->keyHash(keys[i], keyLengths[i]), values[i]);
+        }
         return;
     }
 
-    // Read the second part of the command
-    for (i = 0; (c = fgetc(commands)) != ','; i++) {
-        destination[1][i] = c;
+    // Allocate every chained node before taking any lock, as a single insert does
+    if (nodes != NULL) {
+        for (int i = 0; i < count; i++) {
+            nodes[i] = createNode(table, keys[i], keyLengths[i], values[i], plan.hashes[i]);
+            if (nodes[i] == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+            }
+        }
     }
-    destination[1][i] = '\0';
 
-    // Read the third part of the command
-    for (i = 0; (c = fgetc(commands)) != '\n' && c != EOF; i++) {
-        destination[2][i] = c;
+    for (int start = 0, end; start < count; start = end) {
+        end = batchStripeEnd(table, &plan, start, count);
+        int stripe = stripeIndex(table, plan.hashes[plan.order[start]]);
+
+        uint64_t acquired = lockStripe(table, stripe);
+        uint64_t timestamp = acquired;
+        logTrace("%" PRIu64 ": WRITE LOCK ACQUIRED\n", timestamp);
+
+        // Buckets a few keys ahead are fetched while the current key is inserted
+        for (int i = start; i < end && i < start + BATCH_PREFETCH_DISTANCE; i++) {
+            prefetchBucket(table, plan.hashes[plan.order[i]]);
+        }
+
+        int added = 0;
+        for (int i = start; i < end; i++) {
+            if (i + BATCH_PREFETCH_DISTANCE < end) {
+                prefetchBucket(table, plan.hashes[plan.order[i + BATCH_PREFETCH_DISTANCE]]);
+            }
+
+            int k = plan.order[i];
+            statsCountOperation(table->stats, STAT_INSERT);
+            if (nodes != NULL && nodes[k] == NULL) {
+                continue;
+            }
+
+            traceOperation(table, timestamp, "INSERT", plan.hashes[k], keys[k], keyLengths[k], 1, values[k]);
+            added += insertLocked(table, keys[k], keyLengths[k], plan.hashes[k], values[k], nodes != NULL ? &nodes[k] : NULL);
+        }
+
+        timestamp = unlockStripe(table, stripe, acquired);
+        logTrace("%" PRIu64 ": WRITE LOCK RELEASED\n", timestamp);
+
+        if (nodes == NULL) {
+            continue;
+        }
+
+        // Nodes of keys that were already present go back to the slab outside the lock
+        for (int i = start; i < end; i++) {
+            if (nodes[plan.order[i]] != NULL) {
+                freeRecord(table, nodes[plan.order[i]]);
+            }
+        }
+
+        afterInsert(table, added);
     }
-    destination[2][i] = '\0';
+
+    free(nodes);
+    freeBatchPlan(&plan);
 }
 
-// Funtion that handles the command function calls.
-void* handleCommand(void* arg) {
-    char** cmdPieces = (char**)arg;
+// Function that deletes a batch of keys, taking each stripe's write lock once for all of its keys.
+// Hashes may be NULL, in which case they are computed here.
+void chashDeleteBatch(chashTable* table, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, int count) {
+    batchPlan plan;
 
-    if (strcmp(cmdPieces[0], "insert") == 0) {
-        insert((uint8_t*)cmdPieces[1], (uint32_t)atoi(cmdPieces[2]));
+    if (count <= 0) {
+        return;
     }
-    else if (strcmp(cmdPieces[0], "delete") == 0) {
-        delete((uint8_t*)cmdPieces[1]);
+
+    if (planBatch(table, &plan, keys, keyLengths, hashes, count) != 0) {
+        for (int i = 0; i < count; i++) {
+            chashDeleteHashed(table, keys[i], keyLengths[i], hashes != NULL ? hashes[i] : table->keyHash(keys[i], keyLengths[i]));
+        }
+        return;
     }
-    else if (strcmp(cmdPieces[0], "search") == 0) {
-        uint32_t salary = search((uint8_t*)cmdPieces[1]);
 
-        if (salary != 0) {
-            fprintf(output, "SEARCH: %s FOUND with salary %u\n", cmdPieces[1], salary);
+    for (int start = 0, end; start < count; start = end) {
+        end = batchStripeEnd(table, &plan, start, count);
+        int stripe = stripeIndex(table, plan.hashes[plan.order[start]]);
+
+        uint64_t acquired = lockStripe(table, stripe);
+        uint64_t timestamp = acquired;
+        logTrace("%" PRIu64 ": WRITE LOCK ACQUIRED\n", timestamp);
+
+        for (int i = start; i < end && i < start + BATCH_PREFETCH_DISTANCE; i++) {
+            prefetchBucket(table, plan.hashes[plan.order[i]]);
         }
-        else {
-            fprintf(output, "SEARCH: %s NOT FOUND\n", cmdPieces[1]);
+
+        for (int i = start; i < end; i++) {
+            if (i + BATCH_PREFETCH_DISTANCE < end) {
+                prefetchBucket(table, plan.hashes[plan.order[i + BATCH_PREFETCH_DISTANCE]]);
+            }
+
+            int k = plan.order[i];
+            statsCountOperation(table->stats, STAT_DELETE);
+            traceOperation(table, timestamp, "DELETE", plan.hashes[k], keys[k], keyLengths[k], 0, 0);
+            deleteLocked(table, keys[k], keyLengths[k], plan.hashes[k]);
         }
 
-        fprintf(output, "%ld: READ LOCK RELEASED\n", time(NULL));
+        timestamp = unlockStripe(table, stripe, acquired);
+        logTrace("%" PRIu64 ": WRITE LOCK RELEASED\n", timestamp);
+        if (table->tableEngine == ENGINE_CHAINED) {
+            rehashStep(table);
+        }
     }
-    else if (strcmp(cmdPieces[0], "print") == 0) {        
-	printTable();		
+
+    freeBatchPlan(&plan);
+}
+
+// Function that searches for a batch of keys, storing each salary, or 0 when the key
+// isn't there, at the key's position in salaries. Found, when given, gets 1 for every key
+// that is present, so a salary of 0 can be told from a missing key. Hashes may be NULL.
+void chashSearchBatch(chashTable* table, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, int count, uint32_t* salaries, uint8_t* found) {
+    batchPlan plan;
+
+    if (count <= 0) {
+        return;
     }
 
-    return NULL;
+    // Chains are read without locks, so there is no need to group the keys. Bucket heads are fetched
+    // two prefetch distances ahead and the first node one distance ahead, so both are cached in time.
+    if (table->tableEngine == ENGINE_CHAINED) {
+        uint32_t* computed = NULL;
+        if (hashes == NULL) {
+            computed = (uint32_t*)malloc(count * sizeof(uint32_t));
+            if (computed == NULL) {
+                for (int i = 0; i < count; i++) {
+                    salaries[i] = 0;
+                    int present = chashSearch(table, keys[i], keyLengths[i], &salaries[i]);
+                    if (found != NULL) {
+                        found[i] = (uint8_t)present;
+                    }
+                }
+                return;
+            }
+            for (int i = 0; i < count; i++) {
+                computed[i] = table->keyHash(keys[i], keyLengths[i]);
+            }
+            hashes = computed;
+        }
+
+        epochEnter(table->epoch);
+        tableView* view = atomic_load_explicit(&table->readView, memory_order_acquire);
+
+        for (int i = 0; i < count + 2 * BATCH_PREFETCH_DISTANCE; i++) {
+            if (i < count) {
+                __builtin_prefetch(&view->buckets[hashes[i] & (view->size - 1)]);
+            }
+
+            int ahead = i - BATCH_PREFETCH_DISTANCE;
+            if (ahead >= 0 && ahead < count) {
+                hashRecord* head = atomic_load_explicit(&view->buckets[hashes[ahead] & (view->size - 1)], memory_order_relaxed);
+                if (head != NULL && head != MOVED) {
+                    __builtin_prefetch(head);
+                }
+            }
+
+            int k = i - 2 * BATCH_PREFETCH_DISTANCE;
+            if (k >= 0) {
+                statsCountOperation(table->stats, STAT_SEARCH);
+                if (logTraceEnabled()) {
+                    traceOperation(table, currentTimestamp(), "SEARCH", hashes[k], keys[k], keyLengths[k], 0, 0);
+                }
+
+                hashRecord* record = lockFreeFind(table, keys[k], keyLengths[k], hashes[k]);
+                salaries[k] = record != NULL ? atomic_load_explicit(&record->salary, memory_order_relaxed) : 0;
+                if (found != NULL) {
+                    found[k] = record != NULL;
+                }
+            }
+        }
+
+        epochExit(table->epoch);
+        free(computed);
+        return;
+    }
+
+    if (planBatch(table, &plan, keys, keyLengths, hashes, count) != 0) {
+        for (int i = 0; i < count; i++) {
+            salaries[i] = 0;
+            int present = chashSearchHashed(table, keys[i], keyLengths[i], hashes != NULL ? hashes[i] : table->keyHash(keys[i], keyLengths[i]), &salaries[i]);
+            if (found != NULL) {
+                found[i] = (uint8_t)present;
+            }
+        }
+        return;
+    }
+
+    for (int start = 0, end; start < count; start = end) {
+        end = batchStripeEnd(table, &plan, start, count);
+        int stripe = stripeIndex(table, plan.hashes[plan.order[start]]);
+
+        uint64_t acquired = readLockStripe(table, stripe);
+        uint64_t timestamp = acquired;
+        logTrace("%" PRIu64 ": READ LOCK ACQUIRED\n", timestamp);
+
+        for (int i = start; i < end && i < start + BATCH_PREFETCH_DISTANCE; i++) {
+            flatPrefetch(table->flatHashTable, plan.hashes[plan.order[i]]);
+        }
+
+        for (int i = start; i < end; i++) {
+            if (i + BATCH_PREFETCH_DISTANCE < end) {
+                flatPrefetch(table->flatHashTable, plan.hashes[plan.order[i + BATCH_PREFETCH_DISTANCE]]);
+            }
+
+            int k = plan.order[i];
+            statsCountOperation(table->stats, STAT_SEARCH);
+            traceOperation(table, timestamp, "SEARCH", plan.hashes[k], keys[k], keyLengths[k], 0, 0);
+
+            salaries[k] = 0;
+            int present = flatSearch(table->flatHashTable, keys[k], keyLengths[k], plan.hashes[k], &salaries[k]);
+            if (found != NULL) {
+                found[k] = (uint8_t)present;
+            }
+        }
+
+        timestamp = readUnlockStripe(table, stripe, acquired);
+        logTrace("%" PRIu64 ": READ LOCK RELEASED\n", timestamp);
+    }
+
+    freeBatchPlan(&plan);
+}
+
+// Function that copies an entry into the list chashForEach() or chashSnapshot() hands out.
+void appendRecord(void* context, uint32_t hash, const char* name, size_t length, uint32_t salary) {
+	recordList* list = (recordList*)context;
+
+	if (list->count == list->capacity) {
+		int capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+		chashEntry* records = (chashEntry*)realloc(list->records, capacity * sizeof(chashEntry));
+		if (records == NULL) {
+			fprintf(stderr, "Error: couldn't allocate memory to print the table.\n");
+			return;
+		}
+		list->records = records;
+		list->capacity = capacity;
+	}
+
+	char* copy = (char*)malloc(length + 1);
+	if (copy == NULL) {
+		fprintf(stderr, "Error: couldn't allocate memory to print the table.\n");
+		return;
+	}
+	memcpy(copy, name, length + 1);
+
+	chashEntry* record = &list->records[list->count++];
+	record->hash = hash;
+	record->name = copy;
+	record->length = length;
+	record->salary = salary;
+}
+
+// Function that copies every entry of a chain into the list.
+void appendChain(recordList* list, hashRecord* current) {
+	if (current == MOVED)
+		return;
+
+	while (current != NULL) {
+		appendRecord(list, current->hash, keyData(&current->key), current->key.length, current->salary);
+		current = atomic_load_explicit(&current->next, memory_order_acquire);
+	}
+}
+
+// Function that drops the entries appended since a list had count entries.
+void truncateRecords(recordList* list, int count) {
+	while (list->count > count) {
+		free(list->records[--list->count].name);
+	}
 }
 
-// Main function.
-int main() {
-    // Open command file for reading
-    commands = fopen("commands.txt", "r");
+// Function that copies every chain of one stripe out of a table view.
+void appendStripe(chashTable* table, recordList* list, tableView* view, int stripe) {
+	for (uint32_t i = stripe; i < view->size; i += table->lockCount) {
+		appendChain(list, atomic_load_explicit(&view->buckets[i], memory_order_acquire));
+	}
 
-    // Open output file for writing
-    output = fopen("output.txt", "w");
+	// Include buckets a resize in progress hasn't migrated yet
+	for (uint32_t i = stripe; view->oldBuckets != NULL && i < view->oldSize; i += table->lockCount) {
+		appendChain(list, atomic_load_explicit(&view->oldBuckets[i], memory_order_acquire));
+	}
+}
 
-    // Initialize command reader parameters
-    int cmdParamLength = 50;
-    int cmdParameters = 3;
-    char cmdPieces[cmdParameters][cmdParamLength];
+// Function that copies one stripe of the chained table as it stood at a single moment.
+// Writers aren't stopped: the copy is retried if the stripe's version moved underneath it,
+// and only a stripe that keeps changing is read under its lock.
+void snapshotStripe(chashTable* table, recordList* list, int stripe) {
+	int start = list->count;
 
-    // Read the number of threads from the first command
-    parseCommand(commands, cmdPieces);
-    int threads = atoi(cmdPieces[1]);
-    tableSize = threads;
-    fprintf(output, "Running %d threads\n", threads);
+	for (int attempt = 0; attempt < SNAPSHOT_RETRIES; attempt++) {
+		unsigned version = atomic_load_explicit(&table->stripe_locks[stripe].version, memory_order_acquire);
 
-    // Create and initialize the hash table
-    concurrentHashTable = createTable();
+		// A writer is in the middle of this stripe
+		if (version & 1) {
+			sched_yield();
+			continue;
+		}
 
-    // Initialize read and write locks
-    read_locks = (pthread_rwlock_t*)malloc(tableSize * sizeof(pthread_rwlock_t));
-    write_locks = (pthread_mutex_t*)malloc(tableSize * sizeof(pthread_mutex_t));
+		appendStripe(table, list, atomic_load_explicit(&table->readView, memory_order_acquire), stripe);
 
-    for (int i = 0; i < tableSize; i++) {
-        pthread_rwlock_init(&read_locks[i], NULL);
-        pthread_mutex_init(&write_locks[i], NULL);
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&table->stripe_locks[stripe].version, memory_order_relaxed) == version) {
+			return;
+		}
+		truncateRecords(list, start);
+	}
+
+	uint64_t acquired = readLockStripe(table, stripe);
+	appendStripe(table, list, atomic_load_explicit(&table->readView, memory_order_acquire), stripe);
+	readUnlockStripe(table, stripe, acquired);
+}
+
+// Function that appends a copy of every entry of one stripe, as it stood at a single moment, to a list.
+void copyStripe(chashTable* table, recordList* list, int stripe) {
+    if (table->tableEngine == ENGINE_FLAT) {
+        // Flat segments move their slots when they grow, so each one is copied under its read lock
+        uint64_t acquired = readLockStripe(table, stripe);
+        flatForEach(table->flatHashTable, stripe, appendRecord, list);
+        readUnlockStripe(table, stripe, acquired);
     }
+    else {
+        // Nodes writers unlink stay valid until the epoch moves on
+        epochEnter(table->epoch);
+        snapshotStripe(table, list, stripe);
+        epochExit(table->epoch);
+    }
+}
+
+// Function that runs a visitor on every entry. Each stripe is copied as it stood at a single
+// moment and visited after its lock is released, so the visitor may call back into the table.
+// Entries come in no particular order, and a stripe's writes between copies may or may not be seen.
+void chashForEach(chashTable* table, chashVisitor visit, void* context) {
+    statsCountOperation(table->stats, STAT_PRINT);
 
-    // Allocate memory for threads
-    threadsArray = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    // Copies go into a list that is reused for every stripe
+    recordList list = { NULL, 0, 0 };
 
-    // Loop through the commands and create threads to handle each command
-    for (int i = 0; i < threads; i++) {
-        // Parse the next command
-        parseCommand(commands, cmdPieces);		
+    for (int i = 0; i < table->lockCount; i++) {
+        copyStripe(table, &list, i);
 
-        // Allocate memory for command arguments for each thread
-        char** cmdArgs = (char**)malloc(3 * sizeof(char*));
-        for (int j = 0; j < 3; j++) {
-            cmdArgs[j] = strdup(cmdPieces[j]);  // Use strdup to simplify allocation
+        for (int j = 0; j < list.count; j++) {
+            visit(context, list.records[j].hash, list.records[j].name, list.records[j].length, list.records[j].salary);
         }
+        truncateRecords(&list, 0);
+    }
+
+    free(list.records);
+}
 
-        // Create a thread to handle each command
-        pthread_create(&threadsArray[i], NULL, handleCommand, (void*)cmdArgs);
+// Function that copies every entry out of the table into one array the caller owns, for callers
+// that keep the entries past the walk, such as to sort them. Stripes are copied as chashForEach()
+// copies them. Returns NULL with a count of 0 for an empty table. Free with chashFreeSnapshot().
+chashEntry* chashSnapshot(chashTable* table, size_t* count) {
+    statsCountOperation(table->stats, STAT_PRINT);
+
+    recordList list = { NULL, 0, 0 };
+    for (int i = 0; i < table->lockCount; i++) {
+        copyStripe(table, &list, i);
     }
 
-    // Join all threads
-    for (int i = 0; i < threads; i++) {
-        pthread_join(threadsArray[i], NULL);
+    *count = list.count;
+    return list.records;
+}
+
+// Function that frees a snapshot and every name in it.
+void chashFreeSnapshot(chashEntry* entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(entries[i].name);
     }
+    free(entries);
+}
+
+// Function that hashes a key with the table's hash function, as the *Hashed calls expect.
+uint32_t chashHash(const chashTable* table, const uint8_t* key, size_t keyLength) {
+    return table->keyHash(key, keyLength);
+}
 
-    // Log that all threads have finished
-    fprintf(output, "Finished all threads.\n\n");
+// Function that merges every thread's counters for a table. The counts are exact once the
+// threads that used the table have been joined. Returns NULL if it can't allocate.
+chashStats* chashCollectStats(chashTable* table) {
+    threadStats* totals = statsCollect(table->stats);
+    if (totals == NULL) {
+        return NULL;
+    }
 
-    // Print the number of lock acquisitions and releases
-    fprintf(output, "Number of lock acquisitions: %d\n", lockAcquisitions);
-    fprintf(output, "Number of lock releases: %d\n", lockReleases);
+    chashStats* stats = (chashStats*)malloc(sizeof(chashStats));
+    chashStripeStats* stripes = (chashStripeStats*)malloc(table->lockCount * sizeof(chashStripeStats));
+    if (stats == NULL || stripes == NULL) {
+        free(stats);
+        free(stripes);
+        statsFree(totals);
+        return NULL;
+    }
 
-    // Print the hash table
-    printTable();
+    stats->lockAcquisitions = totals->lockAcquisitions;
+    stats->lockReleases = totals->lockReleases;
+    for (int i = 0; i < CHASH_OP_COUNT; i++) {
+        stats->operations[i] = totals->operations[i];
+    }
 
-    // Clean up resources
-    for (int i = 0; i < tableSize; i++) {
-        pthread_rwlock_destroy(&read_locks[i]);
-        pthread_mutex_destroy(&write_locks[i]);
+    stats->stripeCount = table->lockCount;
+    stats->stripes = stripes;
+    for (int i = 0; i < table->lockCount; i++) {
+        stripes[i].acquisitions = totals->stripes[i].acquisitions;
+        stripes[i].trylockFailures = totals->stripes[i].trylockFailures;
+        stripes[i].waitNanos = totals->stripes[i].waitNanos;
+        stripes[i].holdNanos = totals->stripes[i].holdNanos;
     }
 
-    free(threadsArray);
-    free(read_locks);
-    free(write_locks);
-    fclose(commands);
-    fclose(output);
-    cleanupHashTable();
+    statsFree(totals);
+    return stats;
+}
 
-    return 0;
+// Function that frees statistics returned by chashCollectStats().
+void chashFreeStats(chashStats* stats) {
+    if (stats == NULL)
+        return;
+
+    free(stats->stripes);
+    free(stats);
 }
 
+// Function that fills in the options chashCreate() uses when it is given none.
+void chashDefaultOptions(chashOptions* options) {
+    options->engine = CHASH_ENGINE_CHAINED;
+    options->keys = CHASH_KEYS_STRING;
+    options->hash = NULL;
+    options->stripes = 0;
+    options->capacity = 0;
+}
+
+// Function that creates the stripe locks and an empty table for the selected engine.
+// Options may be NULL for the defaults. Returns NULL if an option is invalid or anything can't be allocated.
+chashTable* chashCreate(const chashOptions* options) {
+    chashOptions defaults;
+    if (options == NULL) {
+        chashDefaultOptions(&defaults);
+        options = &defaults;
+    }
+
+    hashFunction function = parseHash(options->hash != NULL ? options->hash : DEFAULT_HASH);
+    if (function == NULL || options->stripes < 0 || options->stripes > CHASH_MAX_STRIPES ||
+        options->capacity > CHASH_MAX_CAPACITY ||
+        (options->engine != CHASH_ENGINE_CHAINED && options->engine != CHASH_ENGINE_FLAT) ||
+        (options->keys != CHASH_KEYS_STRING && options->keys != CHASH_KEYS_INTEGER)) {
+        return NULL;
+    }
+
+    // Integer keys are stored as their eight bytes, so byte-key calls on them hash the same way
+    if (options->keys == CHASH_KEYS_INTEGER) {
+        function = fibonacciHash;
+    }
+
+    chashTable* table = (chashTable*)calloc(1, sizeof(chashTable));
+    if (table == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to hash table.\n");
+        return NULL;
+    }
+    table->tableEngine = options->engine;
+    table->keyHash = function;
+    table->integerKeys = options->keys == CHASH_KEYS_INTEGER;
+    pthread_mutex_init(&table->resizeLock, NULL);
+
+    // Stripes default to a power of two near a few per core, independent of the capacity.
+    // A bucket has to stay on one stripe as the table grows, so the table starts with at least one bucket per stripe.
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    table->lockCount = nextPowerOfTwo(options->stripes > 0 ? options->stripes : (processors > 0 ? processors : 1) * STRIPES_PER_CORE);
+    table->tableSize = nextPowerOfTwo(options->capacity > 0 ? options->capacity : 1);
+    if (table->tableSize < (uint32_t)table->lockCount) {
+        table->tableSize = table->lockCount;
+    }
+
+    // Every table counts its own operations and reclaims its own nodes
+    table->stats = statsCreate(table->lockCount);
+    table->epoch = epochCreate(table);
+    if (table->stats == NULL || table->epoch == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to statistics.\n");
+        chashDestroy(table);
+        return NULL;
+    }
+
+    // Initialize the stripe locks, each on its own cache line. Readers and writers share them.
+    table->stripe_locks = (stripeLock*)aligned_alloc(STRIPE_LOCK_ALIGNMENT, table->lockCount * sizeof(stripeLock));
+    if (table->stripe_locks == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to stripe locks.\n");
+        chashDestroy(table);
+        return NULL;
+    }
+
+    for (int i = 0; i < table->lockCount; i++) {
+        pthread_rwlock_init(&table->stripe_locks[i].lock, NULL);
+        atomic_init(&table->stripe_locks[i].version, 0);
+    }
+
+    // Keys too long to store inline go to an arena shared by the table's stripes
+    table->keyStorage = keyArenaCreate();
+    if (table->keyStorage == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to key storage.\n");
+        chashDestroy(table);
+        return NULL;
+    }
+
+    // Create and initialize the hash table, which grows from here as it fills
+    if (table->tableEngine == ENGINE_FLAT) {
+        table->flatHashTable = flatCreate(table->lockCount, table->tableSize, table->keyStorage);
+        if (table->flatHashTable == NULL) {
+            fprintf(stderr, "Error: couldn't allocate memory to hash table.\n");
+            chashDestroy(table);
+            return NULL;
+        }
+    }
+    else {
+        table->concurrentHashTable = createTable(table);
+        table->recordPool = slabCreate(sizeof(hashRecord));
+        if (table->concurrentHashTable == NULL || table->recordPool == NULL) {
+            fprintf(stderr, "Error: couldn't allocate memory to hash table.\n");
+            chashDestroy(table);
+            return NULL;
+        }
+        atomic_store(&table->resizeThreshold, (uint32_t)table->tableSize * MAX_LOAD_FACTOR);
+        publishView(table);
+    }
+
+    return table;
+}
+
+// Function that frees a table, along with its stripe locks. No other thread may still be using it.
+void chashDestroy(chashTable* table) {
+	if (table == NULL)
+		return;
+
+	for (int i = 0; table->stripe_locks != NULL && i < table->lockCount; i++) {
+		pthread_rwlock_destroy(&table->stripe_locks[i].lock);
+	}
+	free(table->stripe_locks);
+
+	flatDestroy(table->flatHashTable);
+
+	// Nothing reads the table any more, so everything retired can go
+	epochDestroy(table->epoch);
+
+	free(table->concurrentHashTable);
+	free(table->oldHashTable);
+	free(table->readView);
+
+	// Every node lives in a slab, so the chains are released in bulk rather than walked
+	slabDestroy(table->recordPool);
+	keyArenaDestroy(table->keyStorage);
+
+	statsDestroy(table->stats);
+	pthread_mutex_destroy(&table->resizeLock);
+	free(table);
+}
@@ -0,0 +1,151 @@
+// Concurrent Hash Table Library Definitions
+// This is the whole public interface of libchash. Tables are opaque handles, so several
+// independent ones can live in one process, each with its own locks, memory and statistics.
+#ifndef CHASH_H
+#define CHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Marks the functions the shared library exports, everything else in it stays hidden
+#if defined(__GNUC__)
+#define CHASH_API __attribute__((visibility("default")))
+#else
+#define CHASH_API
+#endif
+
+// Storage engines: lock-free readers over chained buckets, or open addressing under stripe locks
+#define CHASH_ENGINE_CHAINED 0
+#define CHASH_ENGINE_FLAT 1
+
+// Key types: byte strings, or 32/64-bit integers stored inline and hashed with a Fibonacci multiply
+#define CHASH_KEYS_STRING 0
+#define CHASH_KEYS_INTEGER 1
+
+// Operations counted in chashStats
+#define CHASH_OP_INSERT 0
+#define CHASH_OP_DELETE 1
+#define CHASH_OP_SEARCH 2
+#define CHASH_OP_FOREACH 3
+#define CHASH_OP_UPDATE 4
+#define CHASH_OP_COUNT 5
+
+// Largest bucket and stripe counts a table supports, after rounding up to a power of two
+#define CHASH_MAX_CAPACITY (1u << 31)
+#define CHASH_MAX_STRIPES (1 << 30)
+
+// Opaque table handle
+typedef struct chash_table chashTable;
+
+// Settings fixed when a table is created. Fill in with chashDefaultOptions() first.
+typedef struct chash_options
+{
+	// CHASH_ENGINE_CHAINED or CHASH_ENGINE_FLAT
+	int engine;
+
+	// CHASH_KEYS_STRING or CHASH_KEYS_INTEGER
+	int keys;
+
+	// jenkins, wyhash or xxhash, NULL for the build's default. Ignored for integer keys.
+	const char* hash;
+
+	// Lock stripes, rounded up to a power of two. 0 picks a few per online core. At most CHASH_MAX_STRIPES.
+	int stripes;
+
+	// Buckets to start with, rounded up to a power of two. The table grows as it fills. At most CHASH_MAX_CAPACITY.
+	uint32_t capacity;
+
+} chashOptions;
+
+// Contention figures for one lock stripe
+typedef struct chash_stripe_stats
+{
+	uint64_t acquisitions;
+	uint64_t trylockFailures;
+	uint64_t waitNanos;
+	uint64_t holdNanos;
+
+} chashStripeStats;
+
+// Counters of one table, summed over every thread that used it
+typedef struct chash_stats
+{
+	uint64_t lockAcquisitions;
+	uint64_t lockReleases;
+	uint64_t operations[CHASH_OP_COUNT];
+
+	int stripeCount;
+	chashStripeStats* stripes;
+
+} chashStats;
+
+// Entry copied out of a table by chashSnapshot(). The NUL-terminated name belongs to the snapshot.
+typedef struct chash_entry
+{
+	uint32_t hash;
+	uint32_t salary;
+	char* name;
+	size_t length;
+
+} chashEntry;
+
+// Fibonacci multiplier, 2^64 divided by the golden ratio
+#define CHASH_FIBONACCI_MULTIPLIER 0x9E3779B97F4A7C15ull
+
+// Function that hashes an integer key the way integer tables do, with a single multiply.
+// The high half of the product is kept, since stripes and buckets are picked from the low bits of the hash.
+static inline uint32_t chashIntegerHash(uint64_t key) {
+	return (uint32_t)((key * CHASH_FIBONACCI_MULTIPLIER) >> 32);
+}
+
+// Function run for every entry by chashForEach(). The key is NUL-terminated and only valid during the call.
+typedef void (*chashVisitor)(void* context, uint32_t hash, const char* key, size_t length, uint32_t value);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Function Prototypes
+CHASH_API void chashDefaultOptions(chashOptions* options);
+CHASH_API chashTable* chashCreate(const chashOptions* options);
+CHASH_API void chashDestroy(chashTable* table);
+CHASH_API uint32_t chashHash(const chashTable* table, const uint8_t* key, size_t keyLength);
+
+CHASH_API void chashInsert(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t value);
+CHASH_API void chashInsertHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t value);
+CHASH_API int chashDelete(chashTable* table, const uint8_t* key, size_t keyLength);
+CHASH_API int chashDeleteHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue);
+CHASH_API int chashSearch(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t* salary);
+CHASH_API int chashSearchHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t* salary);
+
+CHASH_API int chashGetOrInsert(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t value, uint32_t* existing);
+CHASH_API int chashGetOrInsertHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t value, uint32_t* existing);
+CHASH_API int chashCompareAndSwap(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t expected, uint32_t desired, uint32_t* current);
+CHASH_API int chashCompareAndSwapHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t expected, uint32_t desired, uint32_t* current);
+CHASH_API uint32_t chashFetchAdd(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t delta);
+CHASH_API uint32_t chashFetchAddHashed(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t delta);
+CHASH_API uint32_t chashAddFetch(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t delta);
+
+// Integer forms, for 32-bit keys as well: they widen to the table's 64-bit keys
+CHASH_API void chashInsertInteger(chashTable* table, uint64_t key, uint32_t value);
+CHASH_API int chashDeleteInteger(chashTable* table, uint64_t key);
+CHASH_API int chashSearchInteger(chashTable* table, uint64_t key, uint32_t* salary);
+CHASH_API int chashGetOrInsertInteger(chashTable* table, uint64_t key, uint32_t value, uint32_t* existing);
+CHASH_API int chashCompareAndSwapInteger(chashTable* table, uint64_t key, uint32_t expected, uint32_t desired, uint32_t* current);
+CHASH_API uint32_t chashFetchAddInteger(chashTable* table, uint64_t key, uint32_t delta);
+
+CHASH_API void chashInsertBatch(chashTable* table, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, const uint32_t* values, int count);
+CHASH_API void chashDeleteBatch(chashTable* table, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, int count);
+CHASH_API void chashSearchBatch(chashTable* table, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, int count, uint32_t* salaries, uint8_t* found);
+
+CHASH_API void chashForEach(chashTable* table, chashVisitor visit, void* context);
+CHASH_API chashEntry* chashSnapshot(chashTable* table, size_t* count);
+CHASH_API void chashFreeSnapshot(chashEntry* entries, size_t count);
+CHASH_API chashStats* chashCollectStats(chashTable* table);
+CHASH_API void chashFreeStats(chashStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,326 @@
+// Concurrent Hash Table C++ Definitions
+// Header-only typed front end over libchash. Requires C++17.
+#ifndef CHASH_HPP
+#define CHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "chash.h"
+
+namespace chash {
+
+// Marks a hash that is left to the table's own byte hash, chosen by Traits::hash
+struct table_hash
+{
+};
+
+// Multiplicative (Fibonacci) hash for integer keys, a single multiply with no branches.
+// It is the table's own integer hash, so native calls on the handle find the same entries.
+template <class Key, class Enable = void>
+struct hash;
+
+template <class Key>
+struct hash<Key, std::enable_if_t<std::is_integral_v<Key>>>
+{
+	std::uint32_t operator()(Key key) const noexcept { return chashIntegerHash(static_cast<std::uint64_t>(key)); }
+};
+
+// Hash used when none is given: the Fibonacci hash for integers, the table's own for strings
+template <class Key>
+using default_hash = std::conditional_t<std::is_integral_v<Key>, hash<Key>, table_hash>;
+
+// Settings fixed at compile time. Derive from this and override what differs.
+struct default_traits
+{
+	// CHASH_ENGINE_CHAINED or CHASH_ENGINE_FLAT
+	static constexpr int engine = CHASH_ENGINE_CHAINED;
+
+	// Lock stripes and starting buckets, 0 lets the table choose
+	static constexpr int stripes = 0;
+	static constexpr std::uint32_t capacity = 0;
+
+	// Byte hash used for keys hashed by table_hash, nullptr for the build's default
+	static constexpr const char* hash = nullptr;
+};
+
+// How a key type is laid out as the bytes the table stores. Integers are widened to the 64-bit keys
+// of an integer table, inline in the entry and compared as one word. Strings are passed by pointer and length.
+template <class Key, class Enable = void>
+struct key_codec;
+
+template <class Key>
+struct key_codec<Key, std::enable_if_t<std::is_integral_v<Key>>>
+{
+	static constexpr int keys = CHASH_KEYS_INTEGER;
+
+	struct encoded
+	{
+		std::uint64_t value;
+
+		const std::uint8_t* data() const noexcept { return reinterpret_cast<const std::uint8_t*>(&value); }
+		static constexpr std::size_t size() noexcept { return sizeof(std::uint64_t); }
+	};
+
+	static encoded encode(Key key) noexcept { return encoded{ static_cast<std::uint64_t>(key) }; }
+
+	static Key decode(const char* data, std::size_t) noexcept
+	{
+		std::uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return static_cast<Key>(value);
+	}
+};
+
+template <class Key>
+struct key_codec<Key, std::enable_if_t<std::is_same_v<Key, std::string_view> || std::is_same_v<Key, std::string>>>
+{
+	static constexpr int keys = CHASH_KEYS_STRING;
+
+	struct encoded
+	{
+		std::string_view view;
+
+		const std::uint8_t* data() const noexcept { return reinterpret_cast<const std::uint8_t*>(view.data()); }
+		std::size_t size() const noexcept { return view.size(); }
+	};
+
+	static encoded encode(std::string_view key) noexcept { return encoded{ key }; }
+
+	// Keys handed to for_each() only live for the call, so string_view maps get a view of the copy
+	static std::string_view decode(const char* data, std::size_t length) noexcept { return std::string_view(data, length); }
+};
+
+// Concurrent map over one libchash table. Every operation is safe to call from any thread.
+// Values are stored in place in the table's 32-bit slot, so they must be trivially copyable and fit in it.
+template <class Key, class Value = std::uint32_t, class Hash = default_hash<Key>, class Traits = default_traits>
+class concurrent_map
+{
+	static_assert(std::is_trivially_copyable_v<Value>, "values are stored in place and must be trivially copyable");
+	static_assert(sizeof(Value) <= sizeof(std::uint32_t), "values must fit in the table's 32-bit slot");
+	static_assert(Traits::stripes >= 0 && (Traits::stripes & (Traits::stripes - 1)) == 0,
+		"the stripe count must be 0 or a power of two");
+
+	using codec = key_codec<Key>;
+	static constexpr bool table_hashed = std::is_same_v<Hash, table_hash>;
+
+public:
+	using key_type = Key;
+	using mapped_type = Value;
+	using hasher = Hash;
+	using traits_type = Traits;
+
+	static constexpr int stripes = Traits::stripes;
+	static constexpr std::uint32_t capacity = Traits::capacity;
+
+	// Creates an empty table. Throws std::bad_alloc if it can't be created.
+	concurrent_map()
+	{
+		chashOptions options;
+		chashDefaultOptions(&options);
+		options.engine = Traits::engine;
+		options.keys = codec::keys;
+		options.hash = Traits::hash;
+		options.stripes = Traits::stripes;
+		options.capacity = Traits::capacity;
+
+		table_ = chashCreate(&options);
+		if (table_ == nullptr) {
+			throw std::bad_alloc();
+		}
+	}
+
+	~concurrent_map() { chashDestroy(table_); }
+
+	concurrent_map(const concurrent_map&) = delete;
+	concurrent_map& operator=(const concurrent_map&) = delete;
+
+	concurrent_map(concurrent_map&& other) noexcept : table_(std::exchange(other.table_, nullptr)) {}
+
+	concurrent_map& operator=(concurrent_map&& other) noexcept
+	{
+		std::swap(table_, other.table_);
+		return *this;
+	}
+
+	// Inserts a key, or replaces its value if it is already present.
+	void insert(const Key& key, const Value& value)
+	{
+		auto bytes = codec::encode(key);
+		if constexpr (table_hashed) {
+			chashInsert(table_, bytes.data(), bytes.size(), store(value));
+		}
+		else {
+			chashInsertHashed(table_, bytes.data(), bytes.size(), Hash{}(key), store(value));
+		}
+	}
+
+	// Removes a key. Returns whether it was present.
+	bool erase(const Key& key)
+	{
+		auto bytes = codec::encode(key);
+		if constexpr (table_hashed) {
+			return chashDelete(table_, bytes.data(), bytes.size()) != 0;
+		}
+		else {
+			return chashDeleteHashed(table_, bytes.data(), bytes.size(), Hash{}(key)) != 0;
+		}
+	}
+
+	// Looks a key up.
+	std::optional<Value> search(const Key& key) const
+	{
+		auto bytes = codec::encode(key);
+		std::uint32_t slot = 0;
+		int found;
+		if constexpr (table_hashed) {
+			found = chashSearch(table_, bytes.data(), bytes.size(), &slot);
+		}
+		else {
+			found = chashSearchHashed(table_, bytes.data(), bytes.size(), Hash{}(key), &slot);
+		}
+
+		if (!found) {
+			return std::nullopt;
+		}
+		return load(slot);
+	}
+
+	bool contains(const Key& key) const { return search(key).has_value(); }
+
+	// Returns the key's value, inserting it with the given value first if it is missing.
+	Value get_or_insert(const Key& key, const Value& value)
+	{
+		std::uint32_t existing = 0;
+		return get_or_insert_slot(key, store(value), existing) ? load(existing) : value;
+	}
+
+	// Replaces the key's value with desired if it still equals expected, comparing bit patterns.
+	// On a mismatch expected is updated to the value seen. Returns false for a missing key too.
+	bool compare_exchange(const Key& key, Value& expected, const Value& desired)
+	{
+		std::uint32_t current = 0;
+		int swapped = compare_exchange_slot(key, store(expected), store(desired), current);
+		if (swapped == 0) {
+			expected = load(current);
+		}
+		return swapped > 0;
+	}
+
+	// Adds to an integer value, inserting a missing key with delta. Returns the value from before.
+	// The table adds across the whole 32-bit slot, so narrower values are added with a
+	// compare-and-swap loop instead, wrapping at their own width like the value type does.
+	template <class V = Value, class = std::enable_if_t<std::is_integral_v<V>>>
+	Value fetch_add(const Key& key, Value delta)
+	{
+		if constexpr (sizeof(Value) == sizeof(std::uint32_t)) {
+			auto bytes = codec::encode(key);
+			if constexpr (table_hashed) {
+				return load(chashFetchAdd(table_, bytes.data(), bytes.size(), store(delta)));
+			}
+			else {
+				return load(chashFetchAddHashed(table_, bytes.data(), bytes.size(), Hash{}(key), store(delta)));
+			}
+		}
+		else {
+			std::uint32_t seen = 0;
+			for (;;) {
+				if (!get_or_insert_slot(key, store(delta), seen)) {
+					return Value{};
+				}
+
+				// A key erased between the two calls is inserted again
+				int swapped;
+				do {
+					Value previous = load(seen);
+					swapped = compare_exchange_slot(key, seen, store(static_cast<Value>(previous + delta)), seen);
+					if (swapped > 0) {
+						return previous;
+					}
+				} while (swapped == 0);
+			}
+		}
+	}
+
+	// Runs f(key, value) on every entry. Entries come in no particular order and each stripe is
+	// visited as it stood at one moment, after its lock is released.
+	template <class F>
+	void for_each(F&& f) const
+	{
+		chashForEach(table_, &visit<std::remove_reference_t<F>>, &f);
+	}
+
+	// Counters summed over every thread that used the table. Free with chashFreeStats().
+	chashStats* stats() const { return chashCollectStats(table_); }
+
+	// Underlying table. Calls made on it directly must encode and hash keys the way the map does.
+	chashTable* native_handle() const noexcept { return table_; }
+
+private:
+	// Looks a key up, inserting it with slot if it is missing. Returns whether it was present.
+	int get_or_insert_slot(const Key& key, std::uint32_t slot, std::uint32_t& existing)
+	{
+		auto bytes = codec::encode(key);
+		if constexpr (table_hashed) {
+			return chashGetOrInsert(table_, bytes.data(), bytes.size(), slot, &existing);
+		}
+		else {
+			return chashGetOrInsertHashed(table_, bytes.data(), bytes.size(), Hash{}(key), slot, &existing);
+		}
+	}
+
+	// Swaps a key's slot like chashCompareAndSwap(): 1 when swapped, 0 on a mismatch, -1 for a missing key.
+	int compare_exchange_slot(const Key& key, std::uint32_t expected, std::uint32_t desired, std::uint32_t& current)
+	{
+		auto bytes = codec::encode(key);
+		if constexpr (table_hashed) {
+			return chashCompareAndSwap(table_, bytes.data(), bytes.size(), expected, desired, &current);
+		}
+		else {
+			return chashCompareAndSwapHashed(table_, bytes.data(), bytes.size(), Hash{}(key), expected, desired, &current);
+		}
+	}
+
+	// Values are copied bit for bit into the low bytes of the slot
+	static std::uint32_t store(const Value& value) noexcept
+	{
+		if constexpr (std::is_same_v<Value, std::uint32_t>) {
+			return value;
+		}
+		else {
+			std::uint32_t slot = 0;
+			std::memcpy(&slot, &value, sizeof(Value));
+			return slot;
+		}
+	}
+
+	static Value load(std::uint32_t slot) noexcept
+	{
+		if constexpr (std::is_same_v<Value, std::uint32_t>) {
+			return slot;
+		}
+		else {
+			Value value;
+			std::memcpy(&value, &slot, sizeof(Value));
+			return value;
+		}
+	}
+
+	template <class F>
+	static void visit(void* context, std::uint32_t, const char* key, std::size_t length, std::uint32_t value)
+	{
+		(*static_cast<F*>(context))(codec::decode(key, length), load(value));
+	}
+
+	chashTable* table_;
+};
+
+} // namespace chash
+
+#endif
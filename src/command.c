@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "command.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Field used for a key or value the line leaves out, as the old parser did
+static const char commandMissingField[] = "0";
+
+#if defined(__AVX2__)
+
+// Function that returns a bit for every comma or newline in the next 32 bytes.
+static uint32_t scanBlock(const char* p) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)p);
+    __m256i commas = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(','));
+    __m256i newlines = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(commas, newlines));
+}
+
+#elif defined(__SSE2__)
+
+// Function that returns a bit for every comma or newline in the next 16 bytes.
+static uint32_t scanBlock(const char* p) {
+    __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+    __m128i commas = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(','));
+    __m128i newlines = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(commas, newlines));
+}
+
+#else
+
+// Function that returns a bit for every comma or newline in the next 16 bytes.
+static uint32_t scanBlock(const char* p) {
+    uint32_t mask = 0;
+    for (int i = 0; i < COMMAND_SCAN_WIDTH; i++) {
+        if (p[i] == ',' || p[i] == '\n') {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+// Function that returns the first comma or newline at or after p, or end if there is none.
+static const char* scanDelimiter(const char* p, const char* end) {
+    while (end - p >= COMMAND_SCAN_WIDTH) {
+        uint32_t mask = scanBlock(p);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += COMMAND_SCAN_WIDTH;
+    }
+
+    // The tail is shorter than a vector and must not be read past
+    while (p < end && *p != ',' && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+// Function that maps an operation name to its code.
+static int commandOp(const char* name, size_t length) {
+    static const struct { const char* name; size_t length; int op; } ops[] = {
+        { "insert", 6, CMD_INSERT },
+        { "delete", 6, CMD_DELETE },
+        { "search", 6, CMD_SEARCH },
+        { "print", 5, CMD_PRINT },
+        { "threads", 7, CMD_THREADS },
+        { "engine", 6, CMD_ENGINE },
+        { "hash", 4, CMD_HASH },
+        { "keys", 4, CMD_KEYS },
+    };
+
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (ops[i].length == length && memcmp(ops[i].name, name, length) == 0) {
+            return ops[i].op;
+        }
+    }
+    return CMD_UNKNOWN;
+}
+
+// Function that reads a decimal value the way atoi() does, without needing a terminator.
+static uint32_t commandValue(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+
+    int negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) {
+        p++;
+    }
+
+    uint32_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (uint32_t)(*p++ - '0');
+    }
+    return negative ? 0u - value : value;
+}
+
+// Function that reads a little-endian 32-bit word from anywhere in the file.
+static uint32_t commandLoad32(const char* p) {
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    return word;
+}
+
+// Function that writes a 32-bit word little-endian.
+static void commandStore32(char* p, uint32_t word) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    memcpy(p, &word, sizeof(word));
+}
+
+// Function that returns the size of a binary record's fixed fields.
+static size_t commandRecordSize(const commandFile* file) {
+    return file->hashId != HASH_ID_NONE ? COMMAND_HASHED_RECORD_SIZE : COMMAND_RECORD_SIZE;
+}
+
+// Function that reads a whole file into memory, for input that can't be mapped.
+static int commandRead(commandFile* file, int fd) {
+    size_t capacity = 1 << 16;
+    char* data = (char*)malloc(capacity);
+    if (data == NULL) {
+        return -1;
+    }
+
+    for (;;) {
+        if (file->size == capacity) {
+            char* grown = (char*)realloc(data, capacity * 2);
+            if (grown == NULL) {
+                free(data);
+                return -1;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+
+        ssize_t count = read(fd, data + file->size, capacity - file->size);
+        if (count < 0) {
+            free(data);
+            return -1;
+        }
+        if (count == 0) {
+            break;
+        }
+        file->size += (size_t)count;
+    }
+
+    file->data = data;
+    file->mapped = 0;
+    return 0;
+}
+
+// Function that opens a command file, mapping it into memory when it is a regular file.
+commandFile* commandOpen(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    commandFile* file = (commandFile*)calloc(1, sizeof(commandFile));
+    if (file == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // The file is parsed front to back exactly once
+            madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+            file->data = (const char*)data;
+            file->size = (size_t)info.st_size;
+            file->mapped = 1;
+        }
+    }
+
+    if (file->data == NULL && commandRead(file, fd) != 0) {
+        close(fd);
+        free(file);
+        return NULL;
+    }
+
+    // A mapping stays valid after its descriptor is closed
+    close(fd);
+    file->end = file->size;
+
+    // Binary files are recognized by their magic, anything else is parsed as text
+    if (file->size >= COMMAND_HEADER_SIZE && memcmp(file->data, COMMAND_MAGIC, COMMAND_MAGIC_LENGTH) == 0) {
+        if ((uint8_t)file->data[COMMAND_MAGIC_LENGTH] != COMMAND_VERSION) {
+            commandClose(file);
+            return NULL;
+        }
+        file->format = COMMAND_BINARY;
+        file->hashId = (uint8_t)file->data[COMMAND_MAGIC_LENGTH + 1];
+        file->position = COMMAND_HEADER_SIZE;
+    }
+    return file;
+}
+
+// Function that parses the next non-blank line of a text file. Returns 0 at the end.
+static int commandNextText(commandFile* file, commandRecord* record) {
+    const char* end = file->data + file->end;
+
+    while (file->position < file->end) {
+        const char* line = file->data + file->position;
+
+        // Split off the operation and key; the value runs to the end of the line and keeps any further commas
+        const char* fields[3] = { line, NULL, NULL };
+        const char* fieldEnds[3] = { NULL, NULL, NULL };
+        const char* p = line;
+        int field = 0;
+
+        for (;;) {
+            const char* delimiter = field < 2 ? scanDelimiter(p, end) : (const char*)memchr(p, '\n', end - p);
+            if (delimiter == NULL) {
+                delimiter = end;
+            }
+            fieldEnds[field] = delimiter;
+
+            if (delimiter == end || *delimiter == '\n') {
+                p = delimiter;
+                break;
+            }
+            fields[++field] = delimiter + 1;
+            p = delimiter + 1;
+        }
+        file->position = p < end ? (size_t)(p - file->data) + 1 : file->end;
+
+        // Drop the carriage return of a CRLF line
+        if (fieldEnds[field] > fields[field] && fieldEnds[field][-1] == '\r') {
+            fieldEnds[field]--;
+        }
+
+        // Skip blank lines
+        if (field == 0 && fieldEnds[0] == fields[0]) {
+            continue;
+        }
+
+        record->op = commandOp(fields[0], fieldEnds[0] - fields[0]);
+        if (field >= 1) {
+            record->key = fields[1];
+            record->keyLength = (uint32_t)(fieldEnds[1] - fields[1]);
+        }
+        else {
+            record->key = commandMissingField;
+            record->keyLength = 1;
+        }
+        record->value = field >= 2 ? commandValue(fields[2], fieldEnds[2]) : 0;
+        record->hash = 0;
+        record->hashed = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Function that decodes the next record of a binary file. Returns 0 at the end.
+// A record cut short by the end of the file is dropped.
+static int commandNextBinary(commandFile* file, commandRecord* record) {
+    size_t fixed = commandRecordSize(file);
+    size_t left = file->end - file->position;
+    const char* p = file->data + file->position;
+
+    if (left < fixed || commandLoad32(p + 1) > left - fixed) {
+        file->position = file->end;
+        return 0;
+    }
+
+    uint8_t op = (uint8_t)p[0];
+    record->op = op <= CMD_KEYS ? op : CMD_UNKNOWN;
+    record->keyLength = commandLoad32(p + 1);
+    record->value = commandLoad32(p + 5);
+    record->hash = fixed == COMMAND_HASHED_RECORD_SIZE ? commandLoad32(p + 9) : 0;
+    record->hashed = fixed == COMMAND_HASHED_RECORD_SIZE && file->trustHashes;
+    record->key = p + fixed;
+
+    file->position += fixed + record->keyLength;
+    return 1;
+}
+
+// Function that reads the next command, whichever format the file is in. Returns 0 at the end.
+int commandNext(commandFile* file, commandRecord* record) {
+    if (file->format == COMMAND_BINARY) {
+        return commandNextBinary(file, record);
+    }
+    return commandNextText(file, record);
+}
+
+// Function that returns the start of the first command at or after offset.
+// Text lines are found from the offset itself; binary records can only be found by
+// walking their lengths forward from a known record start at or before it.
+size_t commandBoundary(const commandFile* file, size_t from, size_t offset) {
+    if (file->format == COMMAND_BINARY) {
+        size_t fixed = commandRecordSize(file);
+        while (from < offset && file->size - from >= fixed) {
+            uint32_t keyLength = commandLoad32(file->data + from + 1);
+            if (keyLength > file->size - from - fixed) {
+                return file->size;
+            }
+            from += fixed + keyLength;
+        }
+        return from < file->size ? from : file->size;
+    }
+
+    if (offset == 0 || offset >= file->size) {
+        return offset < file->size ? offset : file->size;
+    }
+    if (file->data[offset - 1] == '\n') {
+        return offset;
+    }
+
+    const char* newline = (const char*)memchr(file->data + offset, '\n', file->size - offset);
+    return newline != NULL ? (size_t)(newline - file->data) + 1 : file->size;
+}
+
+// Function that makes a view of the lines between two line starts, for parsing on another thread.
+// The range shares the file's data and is never closed itself.
+void commandRange(const commandFile* file, size_t begin, size_t end, commandFile* range) {
+    range->data = file->data;
+    range->size = file->size;
+    range->position = begin;
+    range->end = end;
+    range->mapped = -1;
+    range->format = file->format;
+    range->hashId = file->hashId;
+    range->trustHashes = file->trustHashes;
+}
+
+// Function that copies a record's key into a NUL-terminated buffer, truncating it if needed.
+// Returns the number of bytes copied.
+int commandKeyCopy(const commandRecord* record, char* buffer, size_t capacity) {
+    size_t length = record->keyLength < capacity - 1 ? record->keyLength : capacity - 1;
+    memcpy(buffer, record->key, length);
+    buffer[length] = '\0';
+    return (int)length;
+}
+
+// Function that reads a record's key as an unsigned decimal integer, for integer-keyed tables.
+// Returns 0 unless the key is one or more digits whose value fits in 64 bits.
+int commandKeyInteger(const commandRecord* record, uint64_t* key) {
+    const char* p = record->key;
+    const char* end = p + record->keyLength;
+
+    if (p == end) {
+        return 0;
+    }
+
+    uint64_t value = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') {
+            return 0;
+        }
+
+        uint64_t digit = (uint64_t)(*p - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return 0;
+        }
+        value = value * 10 + digit;
+    }
+
+    *key = value;
+    return 1;
+}
+
+// Function that rewrites every command of a file in the binary format, with each key's hash
+// precomputed by the given function. Returns the number of records written, or -1 on error.
+long commandConvert(commandFile* file, const char* path, hashFunction hash, int hashId) {
+    FILE* out = fopen(path, "wb");
+    if (out == NULL) {
+        return -1;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+    char header[COMMAND_HEADER_SIZE] = { 0 };
+    memcpy(header, COMMAND_MAGIC, COMMAND_MAGIC_LENGTH);
+    header[COMMAND_MAGIC_LENGTH] = COMMAND_VERSION;
+    header[COMMAND_MAGIC_LENGTH + 1] = (char)hashId;
+    int failed = fwrite(header, 1, sizeof(header), out) != sizeof(header);
+
+    // Start over from the first command, directives included
+    file->position = file->format == COMMAND_BINARY ? COMMAND_HEADER_SIZE : 0;
+    file->end = file->size;
+
+    commandRecord record;
+    long count = 0;
+    while (!failed && commandNext(file, &record)) {
+        char fixed[COMMAND_HASHED_RECORD_SIZE];
+        size_t fixedSize = hashId != HASH_ID_NONE ? COMMAND_HASHED_RECORD_SIZE : COMMAND_RECORD_SIZE;
+        fixed[0] = (char)record.op;
+        commandStore32(fixed + 1, record.keyLength);
+        commandStore32(fixed + 5, record.value);
+        if (hashId != HASH_ID_NONE) {
+            commandStore32(fixed + 9, hash((const uint8_t*)record.key, record.keyLength));
+        }
+
+        failed = fwrite(fixed, 1, fixedSize, out) != fixedSize
+              || fwrite(record.key, 1, record.keyLength, out) != record.keyLength;
+        count++;
+    }
+
+    if (fclose(out) != 0 || failed) {
+        return -1;
+    }
+    return count;
+}
+
+// Function that unmaps or frees a command file. Records from it are invalid afterwards.
+void commandClose(commandFile* file) {
+    if (file == NULL)
+        return;
+
+    if (file->mapped) {
+        munmap((void*)file->data, file->size);
+    }
+    else {
+        free((void*)file->data);
+    }
+    free(file);
+}
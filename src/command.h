@@ -0,0 +1,87 @@
+// Command File Definitions
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hashfn.h"
+
+// Operations a command line can name
+#define CMD_UNKNOWN 0
+#define CMD_INSERT 1
+#define CMD_DELETE 2
+#define CMD_SEARCH 3
+#define CMD_PRINT 4
+#define CMD_THREADS 5
+#define CMD_ENGINE 6
+#define CMD_HASH 7
+#define CMD_KEYS 8
+
+// Command file formats, told apart by the magic at the start of binary files
+#define COMMAND_TEXT 0
+#define COMMAND_BINARY 1
+
+// Binary files open with the magic, a version byte and the id of the hash function
+// their records' hashes were computed with (HASH_ID_NONE when they carry none), padded to 16 bytes.
+// Each record is an opcode byte, the key length and value as little-endian 32-bit words,
+// the precomputed hash when the file has them, then the key bytes.
+#define COMMAND_MAGIC "CHASHCMD"
+#define COMMAND_MAGIC_LENGTH 8
+#define COMMAND_VERSION 1
+#define COMMAND_HEADER_SIZE 16
+#define COMMAND_RECORD_SIZE 9
+#define COMMAND_HASHED_RECORD_SIZE 13
+
+// Delimiters are scanned for one vector at a time: 32 bytes with AVX2, otherwise 16
+#if defined(__AVX2__)
+#define COMMAND_SCAN_WIDTH 32
+#else
+#define COMMAND_SCAN_WIDTH 16
+#endif
+
+// One parsed command. The key points into the command file and is not NUL-terminated.
+// Hashed is set when the hash came precomputed with the table's hash function.
+typedef struct command_record
+{
+	int op;
+	uint32_t keyLength;
+	const char* key;
+	uint32_t value;
+	uint32_t hash;
+	int hashed;
+
+} commandRecord;
+
+// Command file mapped into memory, or read into a buffer when it can't be mapped.
+// Parsing runs from position to end, which a range narrows to part of the file.
+// Precomputed hashes are only handed out once trustHashes says they match the table's hash.
+typedef struct command_file
+{
+	const char* data;
+	size_t size;
+	size_t position;
+	size_t end;
+	int mapped;
+
+	int format;
+	int hashId;
+	int trustHashes;
+
+} commandFile;
+
+// Function that tells whether a command works on a key: an insert, delete or search.
+static inline int commandHasKey(const commandRecord* record) {
+	return record->op == CMD_INSERT || record->op == CMD_DELETE || record->op == CMD_SEARCH;
+}
+
+// Function Prototypes
+commandFile* commandOpen(const char* path);
+int commandNext(commandFile* file, commandRecord* record);
+size_t commandBoundary(const commandFile* file, size_t from, size_t offset);
+void commandRange(const commandFile* file, size_t begin, size_t end, commandFile* range);
+void commandClose(commandFile* file);
+int commandKeyCopy(const commandRecord* record, char* buffer, size_t capacity);
+int commandKeyInteger(const commandRecord* record, uint64_t* key);
+long commandConvert(commandFile* file, const char* path, hashFunction hash, int hashId);
+
+#endif
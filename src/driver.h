@@ -0,0 +1,81 @@
+// Command-File Driver Definitions
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "chash.h"
+#include "command.h"
+#include "pool.h"
+#include "dump.h"
+#include "hashfn.h"
+#include "log.h"
+#define DEFAULT_QUEUE_DEPTH 1024
+#define PARSE_CHUNK_SIZE (1 << 20)
+#define PARSE_BUFFER_RECORDS 4096
+#define INTEGER_KEY_DIGITS 21
+
+// Command file split into chunks that parser threads claim in order
+typedef struct parse_job
+{
+	commandFile* file;
+	workerPool* pool;
+	size_t begin;
+	size_t chunkSize;
+	size_t chunkCount;
+	size_t* starts;
+	atomic_size_t nextChunk;
+
+	// In ordered mode chunks are handed to the pool one after another, in file order
+	int ordered;
+	size_t nextDispatch;
+	pthread_mutex_t turnLock;
+	pthread_cond_t turn;
+
+} parseJob;
+
+// Records one parser has read from its current chunk
+typedef struct parse_buffer
+{
+	commandRecord* records;
+	commandRecord* sorted;
+	int* lanes;
+	int* laneCounts;
+	int count;
+	int capacity;
+
+} parseBuffer;
+
+// Function Prototypes
+void logSearchResult(const commandRecord* cmd, int found, uint32_t salary);
+void handleCommand(commandRecord* cmd);
+void handleCommands(void* items, int count);
+void printIntegerKeys(dumpRecord* records, size_t count);
+void printTable();
+void printStats();
+uint32_t commandHash(const commandRecord* record);
+void dispatchLanes(workerPool* pool, parseBuffer* buffer, int begin, int end);
+void dispatchRecords(parseJob* job, parseBuffer* buffer);
+int growParseBuffer(parseBuffer* buffer, int laneCount);
+void waitForTurn(parseJob* job, size_t chunk);
+void passTurn(parseJob* job);
+void* parseWorker(void* arg);
+void parseCommands(commandFile* file, size_t begin, workerPool* pool, int parsers, int ordered);
+int parseEngine(const char* name);
+int parseKeys(const char* name);
+void printUsage(const char* program);
+
+// Global Variables, defined in main.c
+extern chashTable* table;
+extern int workerCount;
+extern int integerKeys;
+extern commandFile* commands;
+extern FILE* output;
+
+#endif
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dump.h"
+
+// Function that compares the hashes of two dump records, for qsort.
+int compareDumpRecords(const void* a, const void* b) {
+    uint32_t hashA = ((const dumpRecord*)a)->hash;
+    uint32_t hashB = ((const dumpRecord*)b)->hash;
+
+    // Subtracting unsigned hashes would wrap, so compare instead
+    return (hashA > hashB) - (hashA < hashB);
+}
+
+// Function that returns the first record of a thread's share of the job.
+static size_t dumpChunkStart(const dumpJob* job, int index) {
+    return (size_t)((unsigned __int128)job->count * index / job->threads);
+}
+
+// Function that helper threads start in. They wait until the caller knows how many
+// threads it managed to start, since every share depends on that count.
+static void* dumpHelperMain(void* arg) {
+    dumpWorker* worker = (dumpWorker*)arg;
+    dumpJob* job = worker->job;
+
+    pthread_mutex_lock(&job->gateLock);
+    while (!job->open) {
+        pthread_cond_wait(&job->gate, &job->gateLock);
+    }
+    pthread_mutex_unlock(&job->gateLock);
+
+    return job->worker(arg);
+}
+
+// Function that runs a worker on every thread of a job, the caller being thread 0.
+// If fewer threads can be started the job is split between those that were.
+static int dumpRun(dumpJob* job, void* (*worker)(void*)) {
+    pthread_t* threads = (pthread_t*)malloc(job->threads * sizeof(pthread_t));
+    dumpWorker* workers = (dumpWorker*)malloc(job->threads * sizeof(dumpWorker));
+    if (threads == NULL || workers == NULL) {
+        free(threads);
+        free(workers);
+        return -1;
+    }
+
+    job->worker = worker;
+    job->open = 0;
+    pthread_mutex_init(&job->gateLock, NULL);
+    pthread_cond_init(&job->gate, NULL);
+
+    int started = 1;
+    for (int i = 0; i < job->threads; i++) {
+        workers[i].job = job;
+        workers[i].index = i;
+    }
+    while (started < job->threads && pthread_create(&threads[started], NULL, dumpHelperMain, &workers[started]) == 0) {
+        started++;
+    }
+
+    // Fix the thread count before anyone computes its share
+    job->threads = started;
+    pthread_barrier_init(&job->barrier, NULL, started);
+
+    pthread_mutex_lock(&job->gateLock);
+    job->open = 1;
+    pthread_cond_broadcast(&job->gate);
+    pthread_mutex_unlock(&job->gateLock);
+
+    worker(&workers[0]);
+    for (int i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_barrier_destroy(&job->barrier);
+    pthread_cond_destroy(&job->gate);
+    pthread_mutex_destroy(&job->gateLock);
+    free(threads);
+    free(workers);
+    return 0;
+}
+
+// Function that runs one thread's share of a least-significant-digit radix sort.
+// Every pass counts digits per thread, then each thread scatters its own share
+// to offsets that keep equal digits in thread order, so the sort is stable.
+static void* dumpSortWorker(void* arg) {
+    dumpWorker* worker = (dumpWorker*)arg;
+    dumpJob* job = worker->job;
+    int me = worker->index;
+
+    size_t begin = dumpChunkStart(job, me);
+    size_t end = dumpChunkStart(job, me + 1);
+    dumpRecord* source = job->records;
+    dumpRecord* target = job->scratch;
+
+    for (int pass = 0; pass < DUMP_RADIX_PASSES; pass++) {
+        int shift = pass * DUMP_RADIX_BITS;
+        size_t* histogram = job->histograms[me];
+
+        memset(histogram, 0, DUMP_RADIX_BUCKETS * sizeof(size_t));
+        for (size_t i = begin; i < end; i++) {
+            histogram[(source[i].hash >> shift) & (DUMP_RADIX_BUCKETS - 1)]++;
+        }
+        pthread_barrier_wait(&job->barrier);
+
+        // Each bucket starts after every smaller digit, then after earlier threads' share of it
+        size_t offsets[DUMP_RADIX_BUCKETS];
+        size_t position = 0;
+        int skip = 0;
+        for (int digit = 0; digit < DUMP_RADIX_BUCKETS; digit++) {
+            size_t total = 0;
+            for (int t = 0; t < job->threads; t++) {
+                if (t == me) {
+                    offsets[digit] = position + total;
+                }
+                total += job->histograms[t][digit];
+            }
+
+            // A pass where every hash has the same digit would move nothing
+            skip |= total == job->count;
+            position += total;
+        }
+
+        if (!skip) {
+            for (size_t i = begin; i < end; i++) {
+                target[offsets[(source[i].hash >> shift) & (DUMP_RADIX_BUCKETS - 1)]++] = source[i];
+            }
+
+            dumpRecord* swap = source;
+            source = target;
+            target = swap;
+        }
+        pthread_barrier_wait(&job->barrier);
+    }
+
+    // An odd number of scatters leaves the result in the scratch array
+    if (source != job->records) {
+        memcpy(job->records + begin, source + begin, (end - begin) * sizeof(dumpRecord));
+    }
+    return NULL;
+}
+
+// Function that sorts dump records by hash, using up to threads threads.
+int dumpSort(dumpRecord* records, size_t count, int threads) {
+    if (count < DUMP_PARALLEL_MIN || threads < 1) {
+        qsort(records, count, sizeof(dumpRecord), compareDumpRecords);
+        return 0;
+    }
+
+    dumpJob job;
+    memset(&job, 0, sizeof(job));
+    job.records = records;
+    job.count = count;
+    job.threads = threads;
+    job.scratch = (dumpRecord*)malloc(count * sizeof(dumpRecord));
+    job.histograms = malloc(threads * sizeof(*job.histograms));
+
+    int result = -1;
+    if (job.scratch != NULL && job.histograms != NULL) {
+        result = dumpRun(&job, dumpSortWorker);
+    }
+
+    free(job.scratch);
+    free(job.histograms);
+
+    // Without the memory for a parallel sort a sequential one still gives the right order
+    if (result != 0) {
+        qsort(records, count, sizeof(dumpRecord), compareDumpRecords);
+    }
+    return 0;
+}
+
+// Function that returns how many decimal digits a number has.
+static size_t dumpDigits(uint32_t value) {
+    size_t digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+// Function that writes a number in decimal and returns the position after it.
+static char* dumpNumber(char* out, uint32_t value) {
+    char digits[10];
+    int count = 0;
+
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+// Function that returns the length of one rendered "hash,name,salary" line.
+static size_t dumpLineLength(const dumpRecord* record) {
+    return dumpDigits(record->hash) + 1 + record->length + 1 + dumpDigits(record->salary) + 1;
+}
+
+// Function that renders one thread's share of a dump into its slice of the text.
+static void* dumpRenderWorker(void* arg) {
+    dumpWorker* worker = (dumpWorker*)arg;
+    dumpJob* job = worker->job;
+    int me = worker->index;
+
+    size_t begin = dumpChunkStart(job, me);
+    size_t end = dumpChunkStart(job, me + 1);
+
+    // Measure this share, then let thread 0 lay the slices out back to back
+    size_t length = 0;
+    for (size_t i = begin; i < end; i++) {
+        length += dumpLineLength(&job->records[i]);
+    }
+    job->offsets[me + 1] = length;
+    pthread_barrier_wait(&job->barrier);
+
+    if (me == 0) {
+        for (int t = 0; t < job->threads; t++) {
+            job->offsets[t + 1] += job->offsets[t];
+        }
+        job->text = (char*)malloc(job->offsets[job->threads] + 1);
+    }
+    pthread_barrier_wait(&job->barrier);
+
+    if (job->text == NULL) {
+        return NULL;
+    }
+
+    char* out = job->text + job->offsets[me];
+    for (size_t i = begin; i < end; i++) {
+        const dumpRecord* record = &job->records[i];
+        out = dumpNumber(out, record->hash);
+        *out++ = ',';
+        memcpy(out, record->name, record->length);
+        out += record->length;
+        *out++ = ',';
+        out = dumpNumber(out, record->salary);
+        *out++ = '\n';
+    }
+    return NULL;
+}
+
+// Function that renders sorted dump records as "hash,name,salary" lines in one buffer.
+// Returns NULL if the buffer couldn't be allocated.
+char* dumpRender(const dumpRecord* records, size_t count, int threads, size_t* length) {
+    dumpJob job;
+    memset(&job, 0, sizeof(job));
+    job.records = (dumpRecord*)records;
+    job.count = count;
+    job.threads = count < DUMP_PARALLEL_MIN || threads < 1 ? 1 : threads;
+
+    // Sized for every thread asked for, fewer may actually start
+    job.offsets = (size_t*)calloc(job.threads + 1, sizeof(size_t));
+    if (job.offsets == NULL || dumpRun(&job, dumpRenderWorker) != 0) {
+        free(job.offsets);
+        return NULL;
+    }
+
+    *length = job.offsets[job.threads];
+    free(job.offsets);
+    return job.text;
+}
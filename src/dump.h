@@ -0,0 +1,58 @@
+// Table Dump Definitions
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "chash.h"
+
+// Below this many entries a dump is sorted and rendered on the calling thread alone
+#define DUMP_PARALLEL_MIN 65536
+
+// The 32-bit hash is sorted one byte per pass
+#define DUMP_RADIX_BITS 8
+#define DUMP_RADIX_BUCKETS (1 << DUMP_RADIX_BITS)
+#define DUMP_RADIX_PASSES (32 / DUMP_RADIX_BITS)
+
+// Entry copied out of the table by printTable(), as chashSnapshot() hands them out
+typedef chashEntry dumpRecord;
+
+// State shared by the threads sorting and rendering one dump
+typedef struct dump_job
+{
+	dumpRecord* records;
+	dumpRecord* scratch;
+	size_t count;
+	int threads;
+
+	// Per-thread digit counts of the current pass
+	size_t (*histograms)[DUMP_RADIX_BUCKETS];
+	pthread_barrier_t barrier;
+
+	// Rendered text, one slice per thread
+	char* text;
+	size_t* offsets;
+
+	// Helper threads wait here until the caller has started all it can
+	void* (*worker)(void*);
+	pthread_mutex_t gateLock;
+	pthread_cond_t gate;
+	int open;
+
+} dumpJob;
+
+// One thread's share of a dump job
+typedef struct dump_worker
+{
+	dumpJob* job;
+	int index;
+
+} dumpWorker;
+
+// Function Prototypes
+int compareDumpRecords(const void* a, const void* b);
+int dumpSort(dumpRecord* records, size_t count, int threads);
+char* dumpRender(const dumpRecord* records, size_t count, int threads, size_t* length);
+
+#endif
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "epoch.h"
+
+// Function that allocates an empty record for a thread first using a domain.
+static localRecord* epochCreateThread(void* context) {
+    (void)context;
+    return (localRecord*)calloc(1, sizeof(epochThread));
+}
+
+// Function that returns this thread's record in a domain, registering it on first use.
+static epochThread* epochSelf(epochDomain* domain) {
+    epochThread* thread = (epochThread*)localSelf(&domain->threads);
+    if (thread == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to epoch record.\n");
+        abort();
+    }
+    return thread;
+}
+
+// Function that moves the global epoch forward if every active thread has caught up.
+static void epochTryAdvance(epochDomain* domain) {
+    uint64_t epoch = atomic_load(&domain->globalEpoch);
+
+    for (localRecord* record = atomic_load(&domain->threads.records); record != NULL; record = record->next) {
+        epochThread* thread = (epochThread*)record;
+        if (atomic_load(&thread->active) && atomic_load(&thread->localEpoch) != epoch) {
+            return;
+        }
+    }
+
+    atomic_compare_exchange_strong(&domain->globalEpoch, &epoch, epoch + 1);
+}
+
+// Function that releases every retired pointer of a thread that is two epochs old.
+// Pointers are retired in epoch order, so the safe ones are always a prefix.
+static void epochScan(epochDomain* domain, epochThread* thread) {
+    uint64_t epoch = atomic_load(&domain->globalEpoch);
+    int released = 0;
+
+    while (released < thread->retiredCount && thread->retired[released].epoch + 2 <= epoch) {
+        thread->retired[released].release(domain->context, thread->retired[released].pointer);
+        released++;
+    }
+
+    thread->retiredCount -= released;
+    for (int i = 0; i < thread->retiredCount; i++) {
+        thread->retired[i] = thread->retired[i + released];
+    }
+}
+
+// Function that creates a domain. Context is handed to every release function.
+epochDomain* epochCreate(void* context) {
+    epochDomain* domain = (epochDomain*)calloc(1, sizeof(epochDomain));
+    if (domain == NULL) {
+        return NULL;
+    }
+
+    if (localRegister(&domain->threads, epochCreateThread, NULL) != 0) {
+        free(domain);
+        return NULL;
+    }
+
+    atomic_init(&domain->globalEpoch, 1);
+    domain->context = context;
+    return domain;
+}
+
+// Function that marks the start of a lock-free read. Calls may nest.
+void epochEnter(epochDomain* domain) {
+    epochThread* thread = epochSelf(domain);
+
+    if (thread->nesting++ > 0) {
+        return;
+    }
+
+    // Publish the epoch this reader started in before touching shared pointers
+    atomic_store(&thread->localEpoch, atomic_load(&domain->globalEpoch));
+    atomic_store(&thread->active, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// Function that marks the end of a lock-free read.
+void epochExit(epochDomain* domain) {
+    epochThread* thread = epochSelf(domain);
+
+    if (--thread->nesting > 0) {
+        return;
+    }
+
+    atomic_store_explicit(&thread->active, 0, memory_order_release);
+}
+
+// Function that defers releasing a pointer that has been unlinked from every shared structure.
+void epochRetire(epochDomain* domain, void* pointer, epochRelease release) {
+    epochThread* thread = epochSelf(domain);
+
+    if (thread->retiredCount == thread->retiredCapacity) {
+        int capacity = thread->retiredCapacity > 0 ? thread->retiredCapacity * 2 : EPOCH_SCAN_THRESHOLD * 2;
+        epochRetired* retired = (epochRetired*)realloc(thread->retired, capacity * sizeof(epochRetired));
+
+        // Without room to defer it the pointer has to leak rather than be freed early
+        if (retired == NULL) {
+            fprintf(stderr, "Error: couldn't allocate memory to retire list.\n");
+            return;
+        }
+
+        thread->retired = retired;
+        thread->retiredCapacity = capacity;
+    }
+
+    thread->retired[thread->retiredCount].pointer = pointer;
+    thread->retired[thread->retiredCount].release = release;
+    thread->retired[thread->retiredCount].epoch = atomic_load(&domain->globalEpoch);
+    thread->retiredCount++;
+
+    if (thread->retiredCount % EPOCH_SCAN_THRESHOLD == 0) {
+        epochTryAdvance(domain);
+        epochScan(domain, thread);
+    }
+}
+
+// Function that releases everything still retired and frees every record and the domain.
+// Only called once no other thread can be inside one of its critical sections.
+void epochDestroy(epochDomain* domain) {
+    if (domain == NULL)
+        return;
+
+    localUnregister(&domain->threads);
+    epochThread* thread = (epochThread*)atomic_exchange(&domain->threads.records, NULL);
+
+    while (thread != NULL) {
+        epochThread* next = (epochThread*)thread->link.next;
+
+        for (int i = 0; i < thread->retiredCount; i++) {
+            thread->retired[i].release(domain->context, thread->retired[i].pointer);
+        }
+
+        free(thread->retired);
+        free(thread);
+        thread = next;
+    }
+
+    free(domain);
+}
@@ -0,0 +1,59 @@
+// Epoch-Based Reclamation Definitions
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "local.h"
+
+// Retired pointers are scanned once a thread has this many waiting
+#define EPOCH_SCAN_THRESHOLD 64
+
+// Function that releases a retired pointer once no reader can still hold it.
+// Context is the one the pointer's domain was created with.
+typedef void (*epochRelease)(void* context, void* pointer);
+
+// Pointer waiting for every reader of its epoch to leave
+typedef struct epoch_retired
+{
+	void* pointer;
+	epochRelease release;
+	uint64_t epoch;
+
+} epochRetired;
+
+// Per-thread reclamation state, linked into its domain's list on first use
+typedef struct epoch_thread
+{
+	localRecord link;
+	atomic_uint_least64_t localEpoch;
+	atomic_int active;
+	int nesting;
+
+	epochRetired* retired;
+	int retiredCount;
+	int retiredCapacity;
+
+} epochThread;
+
+// Independent set of readers and retired pointers, one per table
+typedef struct epoch_domain
+{
+	// Advanced once every active reader has observed the current one
+	atomic_uint_least64_t globalEpoch;
+
+	// Every thread that has ever entered a critical section or retired a pointer
+	localDomain threads;
+	void* context;
+
+} epochDomain;
+
+// Function Prototypes
+epochDomain* epochCreate(void* context);
+void epochEnter(epochDomain* domain);
+void epochExit(epochDomain* domain);
+void epochRetire(epochDomain* domain, void* pointer, epochRelease release);
+void epochDestroy(epochDomain* domain);
+
+#endif
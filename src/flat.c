@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flat.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+
+// Function that returns a bit for every control byte in the group equal to the fragment.
+static uint32_t groupMatch(const int8_t* group, int8_t fragment) {
+    __m256i ctrl = _mm256_load_si256((const __m256i*)group);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(fragment)));
+}
+
+// Function that returns a bit for every empty or deleted slot in the group.
+// Both markers are negative, so their sign bits are exactly the mask.
+static uint32_t groupMatchAvailable(const int8_t* group) {
+    return (uint32_t)_mm256_movemask_epi8(_mm256_load_si256((const __m256i*)group));
+}
+
+#elif defined(__SSE2__)
+
+// Function that returns a bit for every control byte in the group equal to the fragment.
+static uint32_t groupMatch(const int8_t* group, int8_t fragment) {
+    __m128i ctrl = _mm_load_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(fragment)));
+}
+
+// Function that returns a bit for every empty or deleted slot in the group.
+// Both markers are negative, so their sign bits are exactly the mask.
+static uint32_t groupMatchAvailable(const int8_t* group) {
+    return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i*)group));
+}
+
+#else
+
+// Function that returns a bit for every control byte in the group equal to the fragment.
+static uint32_t groupMatch(const int8_t* group, int8_t fragment) {
+    uint32_t mask = 0;
+    for (int i = 0; i < FLAT_GROUP_WIDTH; i++) {
+        if (group[i] == fragment) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+// Function that returns a bit for every empty or deleted slot in the group.
+static uint32_t groupMatchAvailable(const int8_t* group) {
+    uint32_t mask = 0;
+    for (int i = 0; i < FLAT_GROUP_WIDTH; i++) {
+        if (group[i] < 0) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+// Function that picks the segment, and so the lock stripe, of a hash value.
+static flatSegment* segmentFor(flatTable* table, uint32_t hashValue) {
+    return &table->segments[hashValue & (table->segmentCount - 1)];
+}
+
+// The low bits pick the segment, the rest pick the first group to probe.
+static uint32_t firstGroup(flatTable* table, flatSegment* segment, uint32_t hashValue) {
+    uint32_t groupMask = segment->capacity / FLAT_GROUP_WIDTH - 1;
+    return (uint32_t)((uint64_t)hashValue >> table->segmentShift) & groupMask;
+}
+
+// The top 7 bits are kept in the control byte to filter out most mismatches.
+static int8_t hashFragment(uint32_t hashValue) {
+    return (int8_t)(hashValue >> 25);
+}
+
+// Function that allocates the arrays of a segment with every slot empty.
+static int segmentInit(flatSegment* segment, uint32_t capacity) {
+    // Groups are loaded with aligned vector loads
+    segment->ctrl = (int8_t*)aligned_alloc(FLAT_GROUP_WIDTH, capacity);
+    segment->slots = (flatSlot*)malloc(capacity * sizeof(flatSlot));
+
+    if (segment->ctrl == NULL || segment->slots == NULL) {
+        free(segment->ctrl);
+        free(segment->slots);
+        return -1;
+    }
+
+    memset(segment->ctrl, FLAT_EMPTY, capacity);
+    segment->capacity = capacity;
+    segment->count = 0;
+    segment->tombstones = 0;
+    return 0;
+}
+
+// Function that returns the slot holding a key, or -1 when it isn't there.
+static int64_t findSlot(flatTable* table, flatSegment* segment, const uint8_t* key, size_t length, uint32_t hashValue) {
+    uint32_t groupMask = segment->capacity / FLAT_GROUP_WIDTH - 1;
+    uint32_t group = firstGroup(table, segment, hashValue);
+    int8_t fragment = hashFragment(hashValue);
+
+    // Triangular probing over groups visits every group once
+    for (uint32_t step = 1; step <= groupMask + 1; step++) {
+        const int8_t* ctrl = segment->ctrl + (size_t)group * FLAT_GROUP_WIDTH;
+
+        // Only slots whose fragment matches need the full comparison
+        uint32_t match = groupMatch(ctrl, fragment);
+        while (match != 0) {
+            size_t slot = (size_t)group * FLAT_GROUP_WIDTH + __builtin_ctz(match);
+            if (segment->slots[slot].hash == hashValue && keyEquals(&segment->slots[slot].key, key, length)) {
+                return (int64_t)slot;
+            }
+            match &= match - 1;
+        }
+
+        // An empty slot ends the probe sequence, the key was never placed further on
+        if (groupMatch(ctrl, FLAT_EMPTY) != 0) {
+            return -1;
+        }
+
+        group = (group + step) & groupMask;
+    }
+
+    return -1;
+}
+
+// Function that returns the first empty or deleted slot on the key's probe sequence.
+static size_t findAvailable(flatTable* table, flatSegment* segment, uint32_t hashValue) {
+    uint32_t groupMask = segment->capacity / FLAT_GROUP_WIDTH - 1;
+    uint32_t group = firstGroup(table, segment, hashValue);
+
+    for (uint32_t step = 1;; step++) {
+        uint32_t available = groupMatchAvailable(segment->ctrl + (size_t)group * FLAT_GROUP_WIDTH);
+        if (available != 0) {
+            return (size_t)group * FLAT_GROUP_WIDTH + __builtin_ctz(available);
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+// Function that moves every entry of a segment into arrays of a new capacity.
+static int segmentRehash(flatTable* table, flatSegment* segment, uint32_t capacity) {
+    flatSegment resized;
+    if (segmentInit(&resized, capacity) != 0) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < segment->capacity; i++) {
+        if (segment->ctrl[i] >= 0) {
+            size_t slot = findAvailable(table, &resized, segment->slots[i].hash);
+            resized.ctrl[slot] = segment->ctrl[i];
+            resized.slots[slot] = segment->slots[i];
+            resized.count++;
+        }
+    }
+
+    free(segment->ctrl);
+    free(segment->slots);
+    *segment = resized;
+    return 0;
+}
+
+// Function that creates the segments, one per lock stripe.
+// Long keys are stored in the given arena, which outlives the table.
+flatTable* flatCreate(uint32_t segmentCount, uint32_t initialCapacity, keyArena* keys) {
+    flatTable* table = (flatTable*)calloc(1, sizeof(flatTable));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    table->segments = (flatSegment*)calloc(segmentCount, sizeof(flatSegment));
+    if (table->segments == NULL) {
+        free(table);
+        return NULL;
+    }
+
+    table->segmentCount = segmentCount;
+    table->keys = keys;
+    while ((1u << table->segmentShift) < segmentCount) {
+        table->segmentShift++;
+    }
+
+    // Spread the requested capacity over the segments, in whole power-of-two groups
+    uint32_t capacity = FLAT_MIN_CAPACITY;
+    while (capacity * segmentCount < initialCapacity) {
+        capacity <<= 1;
+    }
+
+    for (uint32_t i = 0; i < segmentCount; i++) {
+        if (segmentInit(&table->segments[i], capacity) != 0) {
+            flatDestroy(table);
+            return NULL;
+        }
+    }
+
+    return table;
+}
+
+// Function that inserts or updates a key. The caller holds the key's stripe lock.
+// Returns 1 when a new entry was added, 0 when an existing one was updated and -1 on failure.
+int flatInsert(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue, uint32_t value) {
+    flatSegment* segment = segmentFor(table, hashValue);
+
+    // Update in place if the key is already present
+    int64_t existing = findSlot(table, segment, key, length, hashValue);
+    if (existing >= 0) {
+        segment->slots[existing].salary = value;
+        return 0;
+    }
+
+    // Keep at least one slot in eight empty so probe sequences stay short
+    if ((uint64_t)(segment->count + segment->tombstones + 1) * 8 > (uint64_t)segment->capacity * 7) {
+        // Grow when live entries fill half the segment, otherwise just drop the tombstones
+        uint32_t capacity = segment->capacity;
+        if ((uint64_t)(segment->count + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+        if (segmentRehash(table, segment, capacity) != 0) {
+            fprintf(stderr, "Error: couldn't allocate memory to grow the flat table.\n");
+            return -1;
+        }
+    }
+
+    size_t slot = findAvailable(table, segment, hashValue);
+    if (keyInit(&segment->slots[slot].key, table->keys, key, length) != 0) {
+        fprintf(stderr, "Error: couldn't allocate memory to store the key.\n");
+        return -1;
+    }
+    if (segment->ctrl[slot] == FLAT_DELETED) {
+        segment->tombstones--;
+    }
+
+    segment->ctrl[slot] = hashFragment(hashValue);
+    segment->slots[slot].hash = hashValue;
+    segment->slots[slot].salary = value;
+    segment->count++;
+    return 1;
+}
+
+// Function that removes a key. The caller holds the key's stripe lock.
+// Returns 1 when the key was found.
+int flatDelete(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue) {
+    flatSegment* segment = segmentFor(table, hashValue);
+
+    int64_t slot = findSlot(table, segment, key, length, hashValue);
+    if (slot < 0) {
+        return 0;
+    }
+
+    keyRelease(&segment->slots[slot].key, table->keys);
+
+    // A group that still has an empty slot never let a probe pass through,
+    // so the slot can go straight back to empty instead of becoming a tombstone
+    const int8_t* group = segment->ctrl + (slot / FLAT_GROUP_WIDTH) * FLAT_GROUP_WIDTH;
+    if (groupMatch(group, FLAT_EMPTY) != 0) {
+        segment->ctrl[slot] = FLAT_EMPTY;
+    }
+    else {
+        segment->ctrl[slot] = FLAT_DELETED;
+        segment->tombstones++;
+    }
+
+    segment->count--;
+    return 1;
+}
+
+// Function that looks up a key. The caller holds the key's stripe lock.
+// Returns 1 and stores the salary when the key was found.
+int flatSearch(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue, uint32_t* value) {
+    flatSegment* segment = segmentFor(table, hashValue);
+
+    int64_t slot = findSlot(table, segment, key, length, hashValue);
+    if (slot < 0) {
+        return 0;
+    }
+
+    *value = segment->slots[slot].salary;
+    return 1;
+}
+
+// Function that returns where a key's salary is stored, or NULL when it isn't there.
+// The caller holds the key's stripe lock, its write lock to change the salary.
+uint32_t* flatValue(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue) {
+    flatSegment* segment = segmentFor(table, hashValue);
+
+    int64_t slot = findSlot(table, segment, key, length, hashValue);
+    return slot >= 0 ? &segment->slots[slot].salary : NULL;
+}
+
+// Function that pulls the first group a key probes into the cache ahead of a lookup.
+// The caller holds the key's stripe lock, so the segment can't be resized meanwhile.
+void flatPrefetch(flatTable* table, uint32_t hashValue) {
+    flatSegment* segment = segmentFor(table, hashValue);
+    size_t first = (size_t)firstGroup(table, segment, hashValue) * FLAT_GROUP_WIDTH;
+
+    __builtin_prefetch(segment->ctrl + first);
+    __builtin_prefetch(&segment->slots[first]);
+}
+
+// Function that visits every entry of one segment. The caller holds its stripe lock.
+void flatForEach(flatTable* table, uint32_t segment, flatVisitor visit, void* context) {
+    flatSegment* current = &table->segments[segment];
+
+    for (uint32_t i = 0; i < current->capacity; i++) {
+        if (current->ctrl[i] >= 0) {
+            visit(context, current->slots[i].hash, keyData(&current->slots[i].key), current->slots[i].key.length, current->slots[i].salary);
+        }
+    }
+}
+
+// Function that frees every segment and the table. Long keys go with the arena.
+void flatDestroy(flatTable* table) {
+    if (table == NULL)
+        return;
+
+    for (uint32_t i = 0; i < table->segmentCount; i++) {
+        free(table->segments[i].ctrl);
+        free(table->segments[i].slots);
+    }
+
+    free(table->segments);
+    free(table);
+}
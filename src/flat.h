@@ -0,0 +1,62 @@
+// Open-Addressing Table Definitions
+#ifndef FLAT_H
+#define FLAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "key.h"
+
+// Slots are probed in groups, each slot having one control byte.
+// A group is as wide as one vector compare: 32 with AVX2, otherwise 16.
+#if defined(__AVX2__)
+#define FLAT_GROUP_WIDTH 32
+#else
+#define FLAT_GROUP_WIDTH 16
+#endif
+#define FLAT_MIN_CAPACITY FLAT_GROUP_WIDTH
+#define FLAT_EMPTY ((int8_t)-128)
+#define FLAT_DELETED ((int8_t)-2)
+
+// Entry stored inline in the slot array
+typedef struct flat_slot
+{
+	uint32_t hash;
+	uint32_t salary;
+	hashKey key;
+
+} flatSlot;
+
+// One open-addressing table per lock stripe, so a stripe lock covers every probe
+typedef struct flat_segment
+{
+	int8_t* ctrl;
+	flatSlot* slots;
+	uint32_t capacity;
+	uint32_t count;
+	uint32_t tombstones;
+
+} flatSegment;
+
+typedef struct flat_table
+{
+	flatSegment* segments;
+	uint32_t segmentCount;
+	int segmentShift;
+	keyArena* keys;
+
+} flatTable;
+
+// Function run for every entry by flatForEach().
+typedef void (*flatVisitor)(void* context, uint32_t hash, const char* name, size_t length, uint32_t salary);
+
+// Function Prototypes
+flatTable* flatCreate(uint32_t segmentCount, uint32_t initialCapacity, keyArena* keys);
+int flatInsert(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue, uint32_t value);
+int flatDelete(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue);
+int flatSearch(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue, uint32_t* value);
+uint32_t* flatValue(flatTable* table, const uint8_t* key, size_t length, uint32_t hashValue);
+void flatPrefetch(flatTable* table, uint32_t hashValue);
+void flatForEach(flatTable* table, uint32_t segment, flatVisitor visit, void* context);
+void flatDestroy(flatTable* table);
+
+#endif
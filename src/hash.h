@@ -1,45 +1,172 @@
-// Definitions
-#include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-#include <pthread.h>
-#include <time.h> 
-#define MAX_LINE_LENGTH 1000
-
-// Hash Table Struct
-typedef struct hash_struct
-{
-	uint32_t hash;
-	char name[50];
-	uint32_t salary;
-	struct hash_struct* next;
-
-} hashRecord;
-
-// Function Prototypes
-hashRecord** createTable();
-hashRecord* createNode(uint8_t* key, uint32_t value, uint32_t hashValue);
-uint32_t jenkinsOneAtATime(uint8_t* key, size_t length);
-void insert(uint8_t* key, uint32_t value);
-void delete(uint8_t* key);
-uint32_t search(uint8_t* key);
-void cleanupHashTable();
-uint32_t search(uint8_t* key);
-void parseCommand(FILE* commands, char destination[][50]);
-void* handleCommand(void* arg);
-void printTable();
-int compareHashRecords(const void* a, const void* b);
-
-// Global Variables
-hashRecord** concurrentHashTable;
-pthread_t* threadsArray;
-int threads;
-int tableSize;
-int lockAcquisitions = 0;
-int lockReleases = 0;
-pthread_mutex_t* write_locks;
-pthread_rwlock_t* read_locks;
-FILE* commands;
-FILE* output;
+// Hash Table Internal Definitions, the public interface is chash.h
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h> 
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sched.h>
+#include "chash.h"
+#include "flat.h"
+#include "epoch.h"
+#include "slab.h"
+#include "key.h"
+#include "hashfn.h"
+#include "log.h"
+#include "stats.h"
+#define MAX_LOAD_FACTOR 1
+#define REHASH_STEP 4
+#define ENGINE_CHAINED CHASH_ENGINE_CHAINED
+#define ENGINE_FLAT CHASH_ENGINE_FLAT
+#define STRIPES_PER_CORE 4
+#define STRIPE_LOCK_ALIGNMENT 64
+#define SNAPSHOT_RETRIES 8
+#define BATCH_PREFETCH_DISTANCE 8
+#define UPDATE_GET_OR_INSERT 0
+#define UPDATE_COMPARE_AND_SWAP 1
+#define UPDATE_FETCH_ADD 2
+#define TRACE_KEY_DIGITS 24
+
+// Hash Table Struct
+typedef struct hash_struct
+{
+	_Atomic(struct hash_struct*) next;
+	uint32_t hash;
+	_Atomic uint32_t salary;
+	hashKey key;
+
+} hashRecord;
+
+// Bucket heads are loaded by lock-free readers
+typedef _Atomic(hashRecord*) bucketHead;
+
+// Bucket arrays as seen by lock-free readers, replaced whenever a resize starts or finishes
+typedef struct table_view
+{
+	bucketHead* buckets;
+	uint32_t size;
+	bucketHead* oldBuckets;
+	uint32_t oldSize;
+
+} tableView;
+
+// Stripe lock padded to a cache line so neighbouring stripes don't false-share.
+// The version is bumped before and after every write, for snapshot readers.
+typedef struct stripe_lock
+{
+	pthread_rwlock_t lock;
+	atomic_uint version;
+
+} __attribute__((aligned(STRIPE_LOCK_ALIGNMENT))) stripeLock;
+
+// Marks an old bucket whose chain has been copied into the current array
+#define MOVED (&movedBucket)
+
+// Growable list of copied entries used by chashForEach()
+typedef struct record_list
+{
+	chashEntry* records;
+	int count;
+	int capacity;
+
+} recordList;
+
+// Hashes of a batch of keys and the order that groups them by lock stripe
+typedef struct batch_plan
+{
+	uint32_t* hashes;
+	int* order;
+
+} batchPlan;
+
+// Table state behind the opaque handle of chash.h
+struct chash_table
+{
+	int tableEngine;
+	hashFunction keyHash;
+
+	// Keys are 64-bit integers stored as their bytes, traced in decimal
+	int integerKeys;
+
+	// Chained engine, with the bucket array being migrated away from while a resize is in progress
+	bucketHead* concurrentHashTable;
+	uint32_t tableSize;
+	bucketHead* oldHashTable;
+	uint32_t oldTableSize;
+	_Atomic(tableView*) readView;
+	slabPool* recordPool;
+
+	// Flat engine
+	flatTable* flatHashTable;
+
+	keyArena* keyStorage;
+	int lockCount;
+	stripeLock* stripe_locks;
+
+	// Incremental resize
+	uint32_t resizeGeneration;
+	atomic_int resizing;
+	atomic_uint entryCount;
+	atomic_uint resizeThreshold;
+	atomic_uint rehashedBuckets;
+	atomic_uint_least64_t rehashCursor;
+	pthread_mutex_t resizeLock;
+
+	// Per-table statistics and reclamation, so tables never wait on each other's readers
+	statsDomain* stats;
+	epochDomain* epoch;
+};
+
+// Function Prototypes
+bucketHead* createTable(chashTable* table);
+void publishView(chashTable* table);
+void freeRecord(void* context, void* pointer);
+void freeRetired(void* context, void* pointer);
+hashRecord* lockFreeFind(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue);
+uint32_t nextPowerOfTwo(uint32_t n);
+uint64_t currentTimestamp();
+void traceOperation(const chashTable* table, uint64_t timestamp, const char* operation, uint32_t hashValue,
+                    const uint8_t* key, size_t keyLength, int hasValue, uint32_t value);
+hashRecord* createNode(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t value, uint32_t hashValue);
+uint32_t updatedSalary(int update, uint32_t current, uint32_t operand, uint32_t expected);
+int updateSalary(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, int update, uint32_t operand, uint32_t expected, uint32_t* previous);
+int insertLocked(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue, uint32_t value, hashRecord** node);
+int deleteLocked(chashTable* table, const uint8_t* key, size_t keyLength, uint32_t hashValue);
+int planBatch(chashTable* table, batchPlan* plan, const uint8_t* const* keys, const size_t* keyLengths, const uint32_t* hashes, int count);
+void freeBatchPlan(batchPlan* plan);
+int batchStripeEnd(chashTable* table, const batchPlan* plan, int start, int count);
+void prefetchBucket(chashTable* table, uint32_t hashValue);
+hashRecord* findInChain(hashRecord* current, const uint8_t* key, size_t keyLength, uint32_t hashValue);
+int stripeIndex(chashTable* table, uint32_t hashValue);
+void beginStripeWrite(chashTable* table, int stripe);
+void endStripeWrite(chashTable* table, int stripe);
+void lockAllStripes(chashTable* table);
+void unlockAllStripes(chashTable* table);
+uint64_t lockStripe(chashTable* table, int stripe);
+uint64_t unlockStripe(chashTable* table, int stripe, uint64_t acquired);
+uint64_t readLockStripe(chashTable* table, int stripe);
+uint64_t readUnlockStripe(chashTable* table, int stripe, uint64_t acquired);
+void migrateBucket(chashTable* table, uint32_t oldIndex);
+void startResize(chashTable* table);
+void finishResize(chashTable* table);
+void rehashStep(chashTable* table);
+uint32_t writeBucket(chashTable* table, uint32_t hashValue);
+void afterInsert(chashTable* table, uint32_t added);
+void appendRecord(void* context, uint32_t hash, const char* name, size_t length, uint32_t salary);
+void appendChain(recordList* list, hashRecord* current);
+void truncateRecords(recordList* list, int count);
+void appendStripe(chashTable* table, recordList* list, tableView* view, int stripe);
+void snapshotStripe(chashTable* table, recordList* list, int stripe);
+void copyStripe(chashTable* table, recordList* list, int stripe);
+
+// Marks old buckets that have been migrated, shared by every table and defined in chash.c
+extern hashRecord movedBucket;
+
+#endif
@@ -0,0 +1,236 @@
+#include <string.h>
+#include "chash.h"
+#include "hashfn.h"
+
+// wyhash mixing constants
+static const uint64_t wyp[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+// XXH64 primes
+#define XXH_PRIME1 0x9E3779B185EBCA87ull
+#define XXH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME3 0x165667B19E3779F9ull
+#define XXH_PRIME4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME5 0x27D4EB2F165667C5ull
+
+// Function that reads 8 unaligned little-endian bytes.
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+// Function that reads 4 unaligned little-endian bytes.
+static inline uint64_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Function that folds a 64-bit hash so both halves reach the 32 bits the tables use.
+static inline uint32_t fold64(uint64_t hash) {
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// Hash function. One byte per step, kept for compatibility with earlier output.
+uint32_t jenkinsOneAtATime(const uint8_t* key, size_t length) {
+	size_t i = 0;
+	uint32_t hash = 0;
+	while (i != length) {
+		hash += key[i++];
+		hash += hash << 10;
+		hash ^= hash >> 6;
+	}
+	hash += hash << 3;
+	hash ^= hash >> 11;
+	hash += hash << 15;
+	return hash;
+}
+
+// Function that multiplies two 64-bit words and xors the halves of the 128-bit product.
+static inline uint64_t wymix(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+// Function that computes wyhash, consuming 16 or 48 bytes per step.
+uint64_t wyhash(const uint8_t* key, size_t length, uint64_t seed) {
+    const uint8_t* p = key;
+    uint64_t a, b;
+
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+
+    if (length <= 16) {
+        // Short keys are covered by two overlapping reads from each end
+        if (length >= 4) {
+            size_t step = (length >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + step);
+            b = (read32(p + length - 4) << 32) | read32(p + length - 4 - step);
+        }
+        else if (length > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = length;
+
+        // Three independent lanes keep the multipliers busy on long keys
+        if (i >= 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = wymix(read64(p) ^ wyp[1], read64(p + 8) ^ seed);
+                seed1 = wymix(read64(p + 16) ^ wyp[2], read64(p + 24) ^ seed1);
+                seed2 = wymix(read64(p + 32) ^ wyp[3], read64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= seed1 ^ seed2;
+        }
+
+        while (i > 16) {
+            seed = wymix(read64(p) ^ wyp[1], read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        // The last 16 bytes overlap whatever the loops already consumed
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    a ^= wyp[1];
+    b ^= seed;
+    __uint128_t product = (__uint128_t)a * b;
+    a = (uint64_t)product;
+    b = (uint64_t)(product >> 64);
+    return wymix(a ^ wyp[0] ^ length, b ^ wyp[1]);
+}
+
+// Function that mixes one 8-byte lane into an XXH64 accumulator.
+static inline uint64_t xxhRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * XXH_PRIME2;
+    accumulator = rotl64(accumulator, 31);
+    return accumulator * XXH_PRIME1;
+}
+
+// Function that folds a lane accumulator into the XXH64 result.
+static inline uint64_t xxhMerge(uint64_t hash, uint64_t accumulator) {
+    hash ^= xxhRound(0, accumulator);
+    return hash * XXH_PRIME1 + XXH_PRIME4;
+}
+
+// Function that computes XXH64, consuming 32 bytes per step over four lanes.
+uint64_t xxh64(const uint8_t* key, size_t length, uint64_t seed) {
+    const uint8_t* p = key;
+    const uint8_t* end = key + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint64_t v2 = seed + XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME1;
+
+        do {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16));
+            v4 = xxhRound(v4, read64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxhMerge(hash, v1);
+        hash = xxhMerge(hash, v2);
+        hash = xxhMerge(hash, v3);
+        hash = xxhMerge(hash, v4);
+    }
+    else {
+        hash = seed + XXH_PRIME5;
+    }
+
+    hash += (uint64_t)length;
+
+    // Consume the tail 8, then 4, then 1 byte at a time
+    while (p + 8 <= end) {
+        hash ^= xxhRound(0, read64(p));
+        hash = rotl64(hash, 27) * XXH_PRIME1 + XXH_PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        hash ^= read32(p) * XXH_PRIME1;
+        hash = rotl64(hash, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= (*p++) * XXH_PRIME5;
+        hash = rotl64(hash, 11) * XXH_PRIME1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Function that hashes a key with wyhash, folded to 32 bits.
+uint32_t wyhash32(const uint8_t* key, size_t length) {
+    return fold64(wyhash(key, length, 0));
+}
+
+// Function that hashes a key with XXH64, folded to 32 bits.
+uint32_t xxhash32(const uint8_t* key, size_t length) {
+    return fold64(xxh64(key, length, 0));
+}
+
+// Function that hashes an integer key stored as its eight bytes in host order, as integer tables keep them.
+// Shorter keys are zero-extended.
+uint32_t fibonacciHash(const uint8_t* key, size_t length) {
+    uint64_t value = 0;
+    memcpy(&value, key, length < sizeof(value) ? length : sizeof(value));
+    return chashIntegerHash(value);
+}
+
+// Function that maps a hash name from the command line or command file.
+hashFunction parseHash(const char* name) {
+    if (strcmp(name, "jenkins") == 0) {
+        return jenkinsOneAtATime;
+    }
+    if (strcmp(name, "wyhash") == 0) {
+        return wyhash32;
+    }
+    if (strcmp(name, "xxhash") == 0 || strcmp(name, "xxh64") == 0) {
+        return xxhash32;
+    }
+    return NULL;
+}
+
+// Function that returns the identifier a hash function is recorded under in binary command files.
+int hashFunctionId(hashFunction function) {
+    if (function == jenkinsOneAtATime) {
+        return HASH_ID_JENKINS;
+    }
+    if (function == wyhash32) {
+        return HASH_ID_WYHASH;
+    }
+    if (function == xxhash32) {
+        return HASH_ID_XXHASH;
+    }
+    return HASH_ID_NONE;
+}
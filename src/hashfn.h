@@ -0,0 +1,33 @@
+// Hash Function Definitions
+#ifndef HASHFN_H
+#define HASHFN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hash used when neither the command line nor the command file picks one.
+// Jenkins keeps the hash values in output.txt compatible with earlier runs.
+#ifndef DEFAULT_HASH
+#define DEFAULT_HASH "jenkins"
+#endif
+
+// Identifiers binary command files record their precomputed hashes under
+#define HASH_ID_NONE 0
+#define HASH_ID_JENKINS 1
+#define HASH_ID_WYHASH 2
+#define HASH_ID_XXHASH 3
+
+// Function that hashes a key of known length down to the 32 bits the tables index with.
+typedef uint32_t (*hashFunction)(const uint8_t* key, size_t length);
+
+// Function Prototypes
+uint32_t jenkinsOneAtATime(const uint8_t* key, size_t length);
+uint32_t wyhash32(const uint8_t* key, size_t length);
+uint32_t xxhash32(const uint8_t* key, size_t length);
+uint32_t fibonacciHash(const uint8_t* key, size_t length);
+uint64_t wyhash(const uint8_t* key, size_t length, uint64_t seed);
+uint64_t xxh64(const uint8_t* key, size_t length, uint64_t seed);
+hashFunction parseHash(const char* name);
+int hashFunctionId(hashFunction function);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "key.h"
+
+// Function that returns the size class holding a key of this length, or -1 when none does.
+static int keyClass(size_t length) {
+    // One extra byte for the terminator
+    size_t size = length + 1;
+
+    for (int i = 0; i < KEY_CLASS_COUNT; i++) {
+        if (size <= ((size_t)1 << (KEY_MIN_CLASS_SHIFT + i))) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Function that creates the size classes for long keys.
+keyArena* keyArenaCreate() {
+    keyArena* arena = (keyArena*)calloc(1, sizeof(keyArena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < KEY_CLASS_COUNT; i++) {
+        arena->classes[i] = slabCreate((size_t)1 << (KEY_MIN_CLASS_SHIFT + i));
+        if (arena->classes[i] == NULL) {
+            keyArenaDestroy(arena);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_init(&arena->oversizedLock, NULL);
+    return arena;
+}
+
+// Function that releases every long key at once.
+void keyArenaDestroy(keyArena* arena) {
+    if (arena == NULL)
+        return;
+
+    for (int i = 0; i < KEY_CLASS_COUNT; i++) {
+        slabDestroy(arena->classes[i]);
+    }
+
+    while (arena->oversized != NULL) {
+        keyOversized* next = arena->oversized->next;
+        free(arena->oversized);
+        arena->oversized = next;
+    }
+
+    pthread_mutex_destroy(&arena->oversizedLock);
+    free(arena);
+}
+
+// Function that stores a copy of the key bytes, inline when they fit.
+// Returns -1 when a long key couldn't be allocated.
+int keyInit(hashKey* key, keyArena* arena, const uint8_t* data, size_t length) {
+    if (length > UINT32_MAX - sizeof(keyOversized) - 1) {
+        return -1;
+    }
+
+    key->length = (uint32_t)length;
+
+    if (length < KEY_INLINE_LENGTH) {
+        memcpy(key->inlineData, data, length);
+        key->inlineData[length] = '\0';
+        return 0;
+    }
+
+    char* storage;
+    int sizeClass = keyClass(length);
+    if (sizeClass >= 0) {
+        storage = (char*)slabAlloc(arena->classes[sizeClass]);
+    }
+    else {
+        // Keys beyond the largest class are tracked so the arena can still release them in bulk
+        keyOversized* header = (keyOversized*)malloc(sizeof(keyOversized) + length + 1);
+        storage = NULL;
+        if (header != NULL) {
+            pthread_mutex_lock(&arena->oversizedLock);
+            header->previous = NULL;
+            header->next = arena->oversized;
+            if (arena->oversized != NULL) {
+                arena->oversized->previous = header;
+            }
+            arena->oversized = header;
+            pthread_mutex_unlock(&arena->oversizedLock);
+            storage = (char*)(header + 1);
+        }
+    }
+
+    if (storage == NULL) {
+        return -1;
+    }
+
+    memcpy(storage, data, length);
+    storage[length] = '\0';
+    key->external = storage;
+    return 0;
+}
+
+// Function that gives a long key's storage back to the arena.
+void keyRelease(hashKey* key, keyArena* arena) {
+    if (key->length < KEY_INLINE_LENGTH)
+        return;
+
+    int sizeClass = keyClass(key->length);
+    if (sizeClass >= 0) {
+        slabRelease(arena->classes[sizeClass], key->external);
+        return;
+    }
+
+    keyOversized* header = (keyOversized*)key->external - 1;
+    pthread_mutex_lock(&arena->oversizedLock);
+    if (header->previous != NULL) {
+        header->previous->next = header->next;
+    }
+    else {
+        arena->oversized = header->next;
+    }
+    if (header->next != NULL) {
+        header->next->previous = header->previous;
+    }
+    pthread_mutex_unlock(&arena->oversizedLock);
+    free(header);
+}
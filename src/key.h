@@ -0,0 +1,72 @@
+// Key Storage Definitions
+#ifndef KEY_H
+#define KEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "slab.h"
+
+// Keys shorter than this live inside the entry, longer ones in the arena
+#define KEY_INLINE_LENGTH 24
+
+// Long keys are rounded up to power-of-two size classes from 32 bytes to 32 KiB
+#define KEY_MIN_CLASS_SHIFT 5
+#define KEY_CLASS_COUNT 11
+
+// Key with its length, stored inline when short. Data is always NUL-terminated.
+typedef struct hash_key
+{
+	uint32_t length;
+	union
+	{
+		char inlineData[KEY_INLINE_LENGTH];
+		char* external;
+	};
+
+} hashKey;
+
+// Header of a key too long for any size class
+typedef struct key_oversized
+{
+	struct key_oversized* previous;
+	struct key_oversized* next;
+
+} keyOversized;
+
+// Storage for keys that don't fit inline
+typedef struct key_arena
+{
+	slabPool* classes[KEY_CLASS_COUNT];
+
+	pthread_mutex_t oversizedLock;
+	keyOversized* oversized;
+
+} keyArena;
+
+// Function Prototypes
+keyArena* keyArenaCreate();
+void keyArenaDestroy(keyArena* arena);
+int keyInit(hashKey* key, keyArena* arena, const uint8_t* data, size_t length);
+void keyRelease(hashKey* key, keyArena* arena);
+
+// Function that returns the NUL-terminated bytes of a key.
+static inline const char* keyData(const hashKey* key) {
+	return key->length < KEY_INLINE_LENGTH ? key->inlineData : key->external;
+}
+
+// Function that compares a stored key with a candidate, checking the length first.
+// Eight-byte keys, which is every key of an integer table, are always inline and compare as one word.
+static inline int keyEquals(const hashKey* key, const uint8_t* data, size_t length) {
+	if (length == sizeof(uint64_t)) {
+		uint64_t stored;
+		uint64_t wanted;
+		memcpy(&stored, key->inlineData, sizeof(stored));
+		memcpy(&wanted, data, sizeof(wanted));
+		return key->length == length && stored == wanted;
+	}
+	return key->length == length && memcmp(keyData(key), data, length) == 0;
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "local.h"
+
+// Live domains by slot, only touched when a domain is registered or unregistered
+static pthread_mutex_t localLock = PTHREAD_MUTEX_INITIALIZER;
+static localDomain** localSlots = NULL;
+static uint32_t localSlotCount = 0;
+static uint64_t localNextId = 1;
+
+// One key for the whole process, so a thread's records are handed back when it exits
+static pthread_once_t localKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t localKey;
+static int localKeyReady = 0;
+
+__thread localTable* localThreadTable = NULL;
+
+// Function that moves every record of an exiting thread onto its domain's orphan list, then frees the table.
+// Domains that were unregistered meanwhile freed the records themselves, so only live ones are touched.
+static void localThreadExit(void* value) {
+    localTable* table = (localTable*)value;
+
+    pthread_mutex_lock(&localLock);
+    for (uint32_t slot = 0; slot < table->capacity && slot < localSlotCount; slot++) {
+        localEntry* entry = &table->entries[slot];
+        localDomain* domain = localSlots[slot];
+        if (domain == NULL || entry->record == NULL || entry->id != domain->id) {
+            continue;
+        }
+
+        pthread_mutex_lock(&domain->orphanLock);
+        entry->record->nextOrphan = domain->orphans;
+        domain->orphans = entry->record;
+        pthread_mutex_unlock(&domain->orphanLock);
+    }
+    pthread_mutex_unlock(&localLock);
+
+    if (localThreadTable == table) {
+        localThreadTable = NULL;
+    }
+    free(table);
+}
+
+// Function that creates the process-wide key the first time a domain is registered.
+static void localCreateKey(void) {
+    localKeyReady = pthread_key_create(&localKey, localThreadExit) == 0;
+}
+
+// Function that gives a domain a slot in every thread's table. Create allocates a thread's record on first use.
+// Returns 0 on success and -1 when the slot or the process-wide key couldn't be set up.
+int localRegister(localDomain* domain, localCreate create, void* context) {
+    pthread_once(&localKeyOnce, localCreateKey);
+    if (!localKeyReady) {
+        return -1;
+    }
+
+    domain->create = create;
+    domain->context = context;
+    atomic_init(&domain->records, NULL);
+    domain->orphans = NULL;
+
+    pthread_mutex_lock(&localLock);
+
+    // Take the first free slot, so thread tables stay as small as the number of live domains
+    uint32_t slot = 0;
+    while (slot < localSlotCount && localSlots[slot] != NULL) {
+        slot++;
+    }
+
+    if (slot == localSlotCount) {
+        localDomain** slots = (localDomain**)realloc(localSlots, (localSlotCount + 1) * sizeof(localDomain*));
+        if (slots == NULL) {
+            pthread_mutex_unlock(&localLock);
+            return -1;
+        }
+        localSlots = slots;
+        localSlotCount++;
+    }
+
+    pthread_mutex_init(&domain->orphanLock, NULL);
+    localSlots[slot] = domain;
+    domain->slot = slot;
+    domain->id = localNextId++;
+
+    pthread_mutex_unlock(&localLock);
+    return 0;
+}
+
+// Function that gives this thread a record in a domain, growing the thread's table to reach its slot.
+// A record left behind by an exited thread is adopted before a new one is allocated.
+// Returns NULL when either allocation fails.
+localRecord* localTake(localDomain* domain) {
+    localTable* table = localThreadTable;
+
+    if (table == NULL || domain->slot >= table->capacity) {
+        uint32_t capacity = table != NULL ? table->capacity : 0;
+        uint32_t grown = capacity > 0 ? capacity : LOCAL_TABLE_MIN;
+        while (grown <= domain->slot) {
+            grown *= 2;
+        }
+
+        table = (localTable*)realloc(table, sizeof(localTable) + grown * sizeof(localEntry));
+        if (table == NULL) {
+            return NULL;
+        }
+        memset(&table->entries[capacity], 0, (grown - capacity) * sizeof(localEntry));
+        table->capacity = grown;
+
+        localThreadTable = table;
+        pthread_setspecific(localKey, table);
+    }
+
+    // An adopted record is already on the domain's list and keeps whatever its last owner left in it
+    pthread_mutex_lock(&domain->orphanLock);
+    localRecord* record = domain->orphans;
+    if (record != NULL) {
+        domain->orphans = record->nextOrphan;
+    }
+    pthread_mutex_unlock(&domain->orphanLock);
+
+    if (record == NULL) {
+        record = domain->create(domain->context);
+        if (record == NULL) {
+            return NULL;
+        }
+
+        // Records are only ever pushed, so a plain compare-and-swap push is safe
+        localRecord* head = atomic_load(&domain->records);
+        do {
+            record->next = head;
+        } while (!atomic_compare_exchange_weak(&domain->records, &head, record));
+    }
+
+    table->entries[domain->slot].id = domain->id;
+    table->entries[domain->slot].record = record;
+    return record;
+}
+
+// Function that gives a domain's slot back. The caller then frees every record on the domain's list.
+// Exiting threads check the slot under the same lock, so none touches the orphan list afterwards.
+void localUnregister(localDomain* domain) {
+    pthread_mutex_lock(&localLock);
+    localSlots[domain->slot] = NULL;
+    pthread_mutex_unlock(&localLock);
+
+    pthread_mutex_destroy(&domain->orphanLock);
+}
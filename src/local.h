@@ -0,0 +1,87 @@
+// Per-Thread Record Definitions
+#ifndef LOCAL_H
+#define LOCAL_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Thread tables start with room for this many domains and double from there
+#define LOCAL_TABLE_MIN 16
+
+// Link at the start of every per-thread record, threading it into its domain's list
+typedef struct local_record
+{
+	struct local_record* next;
+
+	// Link on the domain's orphan list once the owning thread has exited
+	struct local_record* nextOrphan;
+
+} localRecord;
+
+// Function that allocates a zeroed record for a thread. Context is the one the domain was registered with.
+typedef localRecord* (*localCreate)(void* context);
+
+// Set of per-thread records, one per slab pool, epoch domain or statistics domain.
+// Every domain shares a single process-wide thread key, so any number of them can be live at once.
+typedef struct local_domain
+{
+	// Index of the domain's entry in every thread's table, reused once the domain is gone
+	uint32_t slot;
+
+	// Tells this domain apart from an earlier one that had the same slot
+	uint64_t id;
+
+	localCreate create;
+	void* context;
+
+	// Every record any thread has taken, only ever pushed
+	_Atomic(localRecord*) records;
+
+	// Records of exited threads, handed to the next thread that needs one
+	pthread_mutex_t orphanLock;
+	localRecord* orphans;
+
+} localDomain;
+
+// One thread's record in one domain
+typedef struct local_entry
+{
+	uint64_t id;
+	localRecord* record;
+
+} localEntry;
+
+// Every record of one thread, indexed by domain slot
+typedef struct local_table
+{
+	uint32_t capacity;
+	localEntry entries[];
+
+} localTable;
+
+// This thread's table, NULL until it first takes a record
+extern __thread localTable* localThreadTable;
+
+// Function Prototypes
+int localRegister(localDomain* domain, localCreate create, void* context);
+localRecord* localTake(localDomain* domain);
+void localUnregister(localDomain* domain);
+
+// Function that returns this thread's record in a domain, or NULL if it hasn't taken one.
+static inline localRecord* localFind(const localDomain* domain) {
+	localTable* table = localThreadTable;
+	if (table == NULL || domain->slot >= table->capacity || table->entries[domain->slot].id != domain->id) {
+		return NULL;
+	}
+	return table->entries[domain->slot].record;
+}
+
+// Function that returns this thread's record in a domain, taking one on first use.
+// Returns NULL when no record could be allocated.
+static inline localRecord* localSelf(localDomain* domain) {
+	localRecord* record = localFind(domain);
+	return record != NULL ? record : localTake(domain);
+}
+
+#endif
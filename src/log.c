@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "log.h"
+
+// File the writer thread appends to
+static FILE* logFile = NULL;
+
+// Whether lock and operation trace lines are recorded at all. Off until logStart() asks for them,
+// so tables used without a log never buffer trace lines nobody writes out.
+static int logTracing = 0;
+
+// Buffers handed over by the workers, newest first
+static _Atomic(logBuffer*) logPending = NULL;
+
+// This thread's partly filled buffer, handed over when the thread exits
+static __thread logBuffer* logCurrent = NULL;
+static pthread_key_t logKey;
+
+// Writer thread and its wakeup
+static pthread_t logWriter;
+static pthread_mutex_t logWakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t logWake = PTHREAD_COND_INITIALIZER;
+static atomic_int logStopping = 0;
+
+// Function that creates an empty buffer able to hold at least capacity bytes.
+static logBuffer* logCreateBuffer(size_t capacity) {
+    logBuffer* buffer = (logBuffer*)malloc(sizeof(logBuffer) + capacity);
+    if (buffer == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to log buffer.\n");
+        return NULL;
+    }
+
+    buffer->next = NULL;
+    buffer->length = 0;
+    buffer->capacity = capacity;
+    return buffer;
+}
+
+// Function that hands a buffer over to the writer thread.
+static void logHandOver(logBuffer* buffer) {
+    if (buffer == NULL)
+        return;
+
+    if (buffer->length == 0) {
+        free(buffer);
+        return;
+    }
+
+    // Producers only ever push, and the writer takes the whole list at once
+    logBuffer* head = atomic_load_explicit(&logPending, memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&logPending, &head, buffer, memory_order_release, memory_order_relaxed));
+
+    // A missed signal only delays the write until the writer's next timeout
+    pthread_cond_signal(&logWake);
+}
+
+// Function that runs when a thread exits, handing over whatever it had not flushed.
+static void logThreadExit(void* buffer) {
+    logHandOver((logBuffer*)buffer);
+}
+
+// Function that writes every buffer handed over so far, in the order they arrived.
+static void logDrain() {
+    logBuffer* list = atomic_exchange_explicit(&logPending, NULL, memory_order_acquire);
+
+    // The list is newest first, so reverse it
+    logBuffer* ordered = NULL;
+    while (list != NULL) {
+        logBuffer* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    while (ordered != NULL) {
+        logBuffer* next = ordered->next;
+        fwrite(ordered->data, 1, ordered->length, logFile);
+        free(ordered);
+        ordered = next;
+    }
+}
+
+// Function that the writer thread runs until logStop() is called.
+static void* logWriterLoop(void* arg) {
+    (void)arg;
+
+    while (!atomic_load(&logStopping)) {
+        logDrain();
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_WRITER_INTERVAL * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_mutex_lock(&logWakeLock);
+        if (atomic_load_explicit(&logPending, memory_order_relaxed) == NULL && !atomic_load(&logStopping)) {
+            pthread_cond_timedwait(&logWake, &logWakeLock, &deadline);
+        }
+        pthread_mutex_unlock(&logWakeLock);
+    }
+
+    // Everything handed over before stopping still gets written
+    logDrain();
+    return NULL;
+}
+
+// Function that makes room for length more bytes in this thread's buffer.
+static logBuffer* logReserve(size_t length) {
+    logBuffer* buffer = logCurrent;
+
+    if (buffer != NULL && buffer->length + length <= buffer->capacity) {
+        return buffer;
+    }
+
+    // Hand over the full buffer and start a new one, sized for the entry if it is unusually long
+    logHandOver(buffer);
+    buffer = logCreateBuffer(length > LOG_BUFFER_SIZE ? length : LOG_BUFFER_SIZE);
+    logCurrent = buffer;
+    pthread_setspecific(logKey, buffer);
+    return buffer;
+}
+
+// Function that formats one entry into this thread's buffer.
+static void logFormat(const char* format, va_list args) {
+    va_list retry;
+    va_copy(retry, args);
+
+    // Try the space left first and only start a new buffer if the entry didn't fit
+    logBuffer* buffer = logCurrent;
+    size_t space = buffer != NULL ? buffer->capacity - buffer->length : 0;
+    int length = vsnprintf(buffer != NULL ? buffer->data + buffer->length : NULL, space, format, args);
+
+    if (length >= 0 && (size_t)length < space) {
+        buffer->length += length;
+    }
+    else if (length >= 0) {
+        // vsnprintf needs room for its terminator even though it isn't kept
+        buffer = logReserve((size_t)length + 1);
+        if (buffer != NULL) {
+            vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, retry);
+            buffer->length += length;
+        }
+    }
+
+    va_end(retry);
+}
+
+// Function that starts the writer thread. Trace lines are dropped unless tracing is set.
+int logStart(FILE* file, int tracing) {
+    logFile = file;
+    logTracing = tracing;
+    atomic_store(&logStopping, 0);
+
+    if (pthread_key_create(&logKey, logThreadExit) != 0) {
+        return -1;
+    }
+    if (pthread_create(&logWriter, NULL, logWriterLoop, NULL) != 0) {
+        pthread_key_delete(logKey);
+        return -1;
+    }
+    return 0;
+}
+
+// Function that hands over this thread's buffer so everything logged so far is written next.
+void logFlush() {
+    logBuffer* buffer = logCurrent;
+    logCurrent = NULL;
+    pthread_setspecific(logKey, NULL);
+    logHandOver(buffer);
+}
+
+// Function that writes out everything logged and stops the writer thread.
+// Worker threads must have exited first so their buffers have been handed over.
+void logStop() {
+    logTracing = 0;
+    logFlush();
+
+    pthread_mutex_lock(&logWakeLock);
+    atomic_store(&logStopping, 1);
+    pthread_cond_signal(&logWake);
+    pthread_mutex_unlock(&logWakeLock);
+
+    pthread_join(logWriter, NULL);
+    pthread_key_delete(logKey);
+    fflush(logFile);
+}
+
+// Function that appends raw bytes to this thread's buffer.
+void logWrite(const char* data, size_t length) {
+    logBuffer* buffer = logReserve(length);
+    if (buffer == NULL)
+        return;
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+// Function that appends a formatted line that is always part of the output.
+void logPrintf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    logFormat(format, args);
+    va_end(args);
+}
+
+// Function that tells whether trace lines are being written, so callers can skip preparing them.
+int logTraceEnabled() {
+    return logTracing;
+}
+
+// Function that appends a lock or operation trace line, unless tracing is off.
+void logTrace(const char* format, ...) {
+    if (!logTracing)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    logFormat(format, args);
+    va_end(args);
+}
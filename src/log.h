@@ -0,0 +1,33 @@
+// Buffered Log Definitions
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Each thread formats into a buffer of this size before handing it to the writer
+#define LOG_BUFFER_SIZE (64 * 1024)
+
+// How long the writer sleeps when no buffer has been handed over, in milliseconds
+#define LOG_WRITER_INTERVAL 10
+
+// Block of formatted output owned by one thread until it is handed to the writer
+typedef struct log_buffer
+{
+	struct log_buffer* next;
+	size_t length;
+	size_t capacity;
+	char data[];
+
+} logBuffer;
+
+// Function Prototypes
+int logStart(FILE* file, int tracing);
+void logStop();
+void logFlush();
+void logWrite(const char* data, size_t length);
+void logPrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void logTrace(const char* format, ...) __attribute__((format(printf, 1, 2)));
+int logTraceEnabled();
+
+#endif
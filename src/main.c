@@ -0,0 +1,681 @@
+#include "driver.h"
+
+// Global Variables
+chashTable* table;
+int workerCount = 1;
+int integerKeys = 0;
+commandFile* commands;
+FILE* output;
+
+// Function that logs the result of a search command. A salary of 0 is a real salary.
+void logSearchResult(const commandRecord* cmd, int found, uint32_t salary) {
+    if (found) {
+        logPrintf("SEARCH: %.*s FOUND with salary %u\n", (int)cmd->keyLength, cmd->key, salary);
+    }
+    else {
+        logPrintf("SEARCH: %.*s NOT FOUND\n", (int)cmd->keyLength, cmd->key);
+    }
+}
+
+// Funtion that handles the command function calls.
+void handleCommand(commandRecord* cmd) {
+    const uint8_t* key = (const uint8_t*)cmd->key;
+
+    // Integer tables take the key's value, parsed from its decimal text. The parsers
+    // have already dropped every command whose key isn't one.
+    if (integerKeys && commandHasKey(cmd)) {
+        uint64_t integer = 0;
+        commandKeyInteger(cmd, &integer);
+        if (cmd->op == CMD_INSERT) {
+            chashInsertInteger(table, integer, cmd->value);
+        }
+        else if (cmd->op == CMD_DELETE) {
+            chashDeleteInteger(table, integer);
+        }
+        else {
+            uint32_t salary = 0;
+            int found = chashSearchInteger(table, integer, &salary);
+            logSearchResult(cmd, found, salary);
+        }
+        return;
+    }
+
+    if (cmd->op == CMD_INSERT) {
+        chashInsertHashed(table, key, cmd->keyLength, commandHash(cmd), cmd->value);
+    }
+    else if (cmd->op == CMD_DELETE) {
+        chashDeleteHashed(table, key, cmd->keyLength, commandHash(cmd));
+    }
+    else if (cmd->op == CMD_SEARCH) {
+        uint32_t salary = 0;
+        int found = chashSearchHashed(table, key, cmd->keyLength, commandHash(cmd), &salary);
+        logSearchResult(cmd, found, salary);
+    }
+    else if (cmd->op == CMD_PRINT) {
+        printTable();
+    }
+}
+
+// Function that handles a run of commands taken off the queue. Consecutive inserts, deletes
+// or searches go through the batch calls. Runs are split wherever the operation changes,
+// so the commands on any one key still run in queue order.
+void handleCommands(void* items, int count) {
+    commandRecord* cmds = (commandRecord*)items;
+    const uint8_t* keys[POOL_BATCH_ITEMS];
+    size_t keyLengths[POOL_BATCH_ITEMS];
+    uint32_t hashes[POOL_BATCH_ITEMS];
+    uint32_t values[POOL_BATCH_ITEMS];
+    uint8_t found[POOL_BATCH_ITEMS];
+    uint64_t integers[POOL_BATCH_ITEMS];
+
+    for (int start = 0, end; start < count; start = end) {
+        int op = cmds[start].op;
+        end = start + 1;
+        while (end < count && cmds[end].op == op) {
+            end++;
+        }
+
+        if (end - start == 1 || !commandHasKey(&cmds[start])) {
+            for (int i = start; i < end; i++) {
+                handleCommand(&cmds[i]);
+            }
+            continue;
+        }
+
+        int batch = end - start;
+        for (int i = 0; i < batch; i++) {
+            commandRecord* cmd = &cmds[start + i];
+            if (integerKeys) {
+                integers[i] = 0;
+                commandKeyInteger(cmd, &integers[i]);
+                keys[i] = (const uint8_t*)&integers[i];
+                keyLengths[i] = sizeof(integers[i]);
+                hashes[i] = chashIntegerHash(integers[i]);
+            }
+            else {
+                keys[i] = (const uint8_t*)cmd->key;
+                keyLengths[i] = cmd->keyLength;
+                hashes[i] = commandHash(cmd);
+            }
+            values[i] = cmd->value;
+        }
+
+        if (op == CMD_INSERT) {
+            chashInsertBatch(table, keys, keyLengths, hashes, values, batch);
+        }
+        else if (op == CMD_DELETE) {
+            chashDeleteBatch(table, keys, keyLengths, hashes, batch);
+        }
+        else {
+            chashSearchBatch(table, keys, keyLengths, hashes, batch, values, found);
+            for (int i = 0; i < batch; i++) {
+                logSearchResult(&cmds[start + i], found[i], values[i]);
+            }
+        }
+    }
+}
+
+// Function that rewrites the keys of an integer table's entries in decimal, as the command file gave them.
+void printIntegerKeys(dumpRecord* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].length != sizeof(uint64_t)) {
+            continue;
+        }
+
+        char* name = (char*)realloc(records[i].name, INTEGER_KEY_DIGITS);
+        if (name == NULL) {
+            fprintf(stderr, "Error: couldn't allocate memory to print the table.\n");
+            continue;
+        }
+
+        uint64_t integer;
+        memcpy(&integer, name, sizeof(integer));
+        records[i].length = (size_t)snprintf(name, INTEGER_KEY_DIGITS, "%" PRIu64, integer);
+        records[i].name = name;
+    }
+}
+
+// Function that print the whole hashtable.
+void printTable() {
+    // Step 1: Copy every entry out of the table, one stripe at a time
+    size_t count = 0;
+    dumpRecord* records = chashSnapshot(table, &count);
+    if (integerKeys) {
+        printIntegerKeys(records, count);
+    }
+
+    // Step 2: Sort the list by hash values, radix sorted across the workers for big tables
+    dumpSort(records, count, workerCount);
+
+    // Step 3: Render every line into one buffer and hand it to the log in a single write
+    size_t length = 0;
+    char* text = dumpRender(records, count, workerCount, &length);
+    if (text != NULL) {
+        logWrite(text, length);
+        free(text);
+    }
+    else {
+        for (size_t i = 0; i < count; i++) {
+            logPrintf("%u,%s,%u\n", records[i].hash, records[i].name, records[i].salary);
+        }
+    }
+
+    // Clean up the copies
+    chashFreeSnapshot(records, count);
+}
+
+// Function that returns a command's key hash, computing it unless the command file carried it.
+uint32_t commandHash(const commandRecord* record) {
+    if (record->hashed) {
+        return record->hash;
+    }
+    if (integerKeys) {
+        uint64_t integer = 0;
+        commandKeyInteger(record, &integer);
+        return chashIntegerHash(integer);
+    }
+    return chashHash(table, (const uint8_t*)record->key, record->keyLength);
+}
+
+// Function that hands the key commands in [begin, end) of a chunk's records to their lanes.
+// Records are split by key so each key always lands in the same lane, keeping the records
+// of each lane in file order.
+void dispatchLanes(workerPool* pool, parseBuffer* buffer, int begin, int end) {
+    // Count each lane's records, then lay the lanes out one after another, stably
+    int* counts = buffer->laneCounts;
+    memset(counts, 0, (pool->laneCount + 1) * sizeof(int));
+    for (int i = begin; i < end; i++) {
+        int lane = commandHash(&buffer->records[i]) % pool->laneCount;
+        buffer->lanes[i] = lane;
+        counts[lane + 1]++;
+    }
+    for (int lane = 0; lane < pool->laneCount; lane++) {
+        counts[lane + 1] += counts[lane];
+    }
+    for (int i = begin; i < end; i++) {
+        buffer->sorted[counts[buffer->lanes[i]]++] = buffer->records[i];
+    }
+
+    // Every lane's start has moved to the next lane's, so each run ends where the next begins
+    int start = 0;
+    for (int lane = 0; lane < pool->laneCount; lane++) {
+        if (counts[lane] > start) {
+            poolSubmitMany(pool, lane, &buffer->sorted[start], counts[lane] - start);
+        }
+        start = counts[lane];
+    }
+}
+
+// Function that hands a chunk's records to the pool. Unordered chunks go to the shared queue
+// as one run. Ordered chunks send key commands to their lanes, and every other command, such
+// as a print, is a barrier: it runs alone once every lane has finished the commands before it.
+void dispatchRecords(parseJob* job, parseBuffer* buffer) {
+    workerPool* pool = job->pool;
+
+    if (!job->ordered || pool->laneCount == 1) {
+        poolSubmitMany(pool, 0, buffer->records, buffer->count);
+        buffer->count = 0;
+        return;
+    }
+
+    int begin = 0;
+    while (begin < buffer->count) {
+        int end = begin;
+        while (end < buffer->count && commandHasKey(&buffer->records[end])) {
+            end++;
+        }
+        dispatchLanes(pool, buffer, begin, end);
+
+        if (end < buffer->count) {
+            poolDrain(pool);
+            poolSubmitMany(pool, 0, &buffer->records[end], 1);
+            poolDrain(pool);
+            end++;
+        }
+        begin = end;
+    }
+    buffer->count = 0;
+}
+
+// Function that grows a parser's record buffer. Returns -1 if it can't.
+int growParseBuffer(parseBuffer* buffer, int laneCount) {
+    int capacity = buffer->capacity > 0 ? buffer->capacity * 2 : PARSE_BUFFER_RECORDS;
+
+    commandRecord* records = (commandRecord*)realloc(buffer->records, capacity * sizeof(commandRecord));
+    if (records == NULL) {
+        return -1;
+    }
+    buffer->records = records;
+
+    commandRecord* sorted = (commandRecord*)realloc(buffer->sorted, capacity * sizeof(commandRecord));
+    if (sorted == NULL) {
+        return -1;
+    }
+    buffer->sorted = sorted;
+
+    int* lanes = (int*)realloc(buffer->lanes, capacity * sizeof(int));
+    if (lanes == NULL) {
+        return -1;
+    }
+    buffer->lanes = lanes;
+
+    if (buffer->laneCounts == NULL) {
+        buffer->laneCounts = (int*)malloc((laneCount + 1) * sizeof(int));
+        if (buffer->laneCounts == NULL) {
+            return -1;
+        }
+    }
+
+    buffer->capacity = capacity;
+    return 0;
+}
+
+// Function that waits until every earlier chunk has been handed to the pool.
+void waitForTurn(parseJob* job, size_t chunk) {
+    pthread_mutex_lock(&job->turnLock);
+    while (job->nextDispatch != chunk) {
+        pthread_cond_wait(&job->turn, &job->turnLock);
+    }
+    pthread_mutex_unlock(&job->turnLock);
+}
+
+// Function that lets the parser of the next chunk hand its records over.
+void passTurn(parseJob* job) {
+    pthread_mutex_lock(&job->turnLock);
+    job->nextDispatch++;
+    pthread_cond_broadcast(&job->turn);
+    pthread_mutex_unlock(&job->turnLock);
+}
+
+// Function that each parser thread runs, claiming chunks of the command file in order
+// until none are left and feeding the pool directly.
+void* parseWorker(void* arg) {
+    parseJob* job = (parseJob*)arg;
+    parseBuffer buffer = { NULL, NULL, NULL, NULL, 0, 0 };
+    commandFile range;
+    commandRecord cmd;
+    uint64_t integer;
+
+    for (;;) {
+        size_t chunk = atomic_fetch_add(&job->nextChunk, 1);
+        if (chunk >= job->chunkCount) {
+            break;
+        }
+
+        // Chunks are cut at command starts, so neighbouring chunks meet exactly
+        commandRange(job->file, job->starts[chunk], job->starts[chunk + 1], &range);
+
+        int haveTurn = !job->ordered;
+        while (commandNext(&range, &cmd)) {
+            // A key that isn't a 64-bit decimal integer would alias another one, so its command is dropped
+            if (integerKeys && commandHasKey(&cmd) &&
+                !commandKeyInteger(&cmd, &integer)) {
+                fprintf(stderr, "Error: skipping command on %.*s, integer keys must be decimal numbers below 2^64.\n",
+                    (int)cmd.keyLength, cmd.key);
+                continue;
+            }
+
+            // A buffer that can't grow is handed over early, once it is this chunk's turn
+            if (buffer.count == buffer.capacity && growParseBuffer(&buffer, job->pool->laneCount) != 0) {
+                if (buffer.capacity == 0) {
+                    fprintf(stderr, "Error: couldn't allocate memory to parse commands.\n");
+                    abort();
+                }
+                if (!haveTurn) {
+                    waitForTurn(job, chunk);
+                    haveTurn = 1;
+                }
+                dispatchRecords(job, &buffer);
+            }
+            buffer.records[buffer.count++] = cmd;
+        }
+
+        if (!haveTurn) {
+            waitForTurn(job, chunk);
+        }
+        dispatchRecords(job, &buffer);
+        if (job->ordered) {
+            passTurn(job);
+        }
+    }
+
+    free(buffer.records);
+    free(buffer.sorted);
+    free(buffer.lanes);
+    free(buffer.laneCounts);
+    return NULL;
+}
+
+// Function that parses the command file from begin to the end on several threads at once.
+// In ordered mode every key's commands reach the pool in file order.
+void parseCommands(commandFile* file, size_t begin, workerPool* pool, int parsers, int ordered) {
+    parseJob job;
+    job.file = file;
+    job.pool = pool;
+    job.begin = begin;
+    job.chunkSize = PARSE_CHUNK_SIZE;
+    job.chunkCount = (file->size - begin + PARSE_CHUNK_SIZE - 1) / PARSE_CHUNK_SIZE;
+    atomic_init(&job.nextChunk, 0);
+    job.ordered = ordered;
+    job.nextDispatch = 0;
+    pthread_mutex_init(&job.turnLock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+
+    // Find where every chunk starts up front. Binary records can only be found by walking
+    // their lengths, so each boundary is searched for from the one before it.
+    job.starts = (size_t*)malloc((job.chunkCount + 1) * sizeof(size_t));
+    if (job.starts == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to parse commands.\n");
+        abort();
+    }
+    job.starts[0] = begin;
+    for (size_t chunk = 1; chunk <= job.chunkCount; chunk++) {
+        job.starts[chunk] = commandBoundary(file, job.starts[chunk - 1], begin + chunk * job.chunkSize);
+    }
+
+    // There's no point in more parsers than chunks. The calling thread is one of them.
+    if ((size_t)parsers > job.chunkCount) {
+        parsers = job.chunkCount > 0 ? (int)job.chunkCount : 1;
+    }
+
+    pthread_t* threads = (pthread_t*)malloc(parsers * sizeof(pthread_t));
+    int started = 1;
+    while (threads != NULL && started < parsers && pthread_create(&threads[started], NULL, parseWorker, &job) == 0) {
+        started++;
+    }
+
+    parseWorker(&job);
+    for (int i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    free(job.starts);
+    pthread_mutex_destroy(&job.turnLock);
+    pthread_cond_destroy(&job.turn);
+}
+
+// Function that prints the merged lock and operation statistics.
+void printStats() {
+    chashStats* totals = chashCollectStats(table);
+    if (totals == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to statistics.\n");
+        return;
+    }
+
+    logPrintf("Number of lock acquisitions: %" PRIu64 "\n", totals->lockAcquisitions);
+    logPrintf("Number of lock releases: %" PRIu64 "\n", totals->lockReleases);
+    logPrintf("Operations: %" PRIu64 " inserts, %" PRIu64 " deletes, %" PRIu64 " searches, %" PRIu64 " prints, %" PRIu64 " updates\n",
+        totals->operations[CHASH_OP_INSERT], totals->operations[CHASH_OP_DELETE],
+        totals->operations[CHASH_OP_SEARCH], totals->operations[CHASH_OP_FOREACH], totals->operations[CHASH_OP_UPDATE]);
+
+    // Only stripes that were ever locked are worth a line
+    for (int i = 0; i < totals->stripeCount; i++) {
+        chashStripeStats* stripe = &totals->stripes[i];
+        if (stripe->acquisitions == 0)
+            continue;
+
+        logPrintf("Stripe %d: %" PRIu64 " acquisitions, %" PRIu64 " trylock failures (%.2f%%), "
+            "average wait %" PRIu64 " ns, average hold %" PRIu64 " ns\n",
+            i, stripe->acquisitions, stripe->trylockFailures,
+            100.0 * stripe->trylockFailures / stripe->acquisitions,
+            stripe->waitNanos / stripe->acquisitions, stripe->holdNanos / stripe->acquisitions);
+    }
+
+    chashFreeStats(totals);
+}
+
+// Function that maps an engine name from the command line or command file.
+int parseEngine(const char* name) {
+    if (strcmp(name, "chained") == 0) {
+        return CHASH_ENGINE_CHAINED;
+    }
+    if (strcmp(name, "flat") == 0) {
+        return CHASH_ENGINE_FLAT;
+    }
+    return -1;
+}
+
+// Function that maps a key type from the command file.
+int parseKeys(const char* name) {
+    if (strcmp(name, "string") == 0) {
+        return CHASH_KEYS_STRING;
+    }
+    if (strcmp(name, "integer") == 0) {
+        return CHASH_KEYS_INTEGER;
+    }
+    return -1;
+}
+
+// Function that prints the command line options.
+void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [-t workers] [-q queue depth] [-e chained|flat] [-H jenkins|wyhash|xxhash] [-s stripes] [-p parsers] [-o] [-n] [-C binary file] [commands file]\n", program);
+}
+
+// Main function.
+int main(int argc, char* argv[]) {
+    // Worker count defaults to the number of online processors, not the threads line
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = processors > 0 ? (int)processors : 1;
+    int queueDepth = DEFAULT_QUEUE_DEPTH;
+    int engineOption = -1;
+    const char* hashOption = NULL;
+    int tracing = 1;
+    int stripeOption = 0;
+    int parsers = 1;
+    int ordered = 0;
+    const char* commandsPath = "commands.txt";
+    const char* convertPath = NULL;
+
+    // Read the command line options
+    int option;
+    while ((option = getopt(argc, argv, "t:q:e:H:s:p:onC:h")) != -1) {
+        switch (option) {
+        case 't':
+            workers = atoi(optarg);
+            break;
+        case 'q':
+            queueDepth = atoi(optarg);
+            break;
+        case 'e':
+            engineOption = parseEngine(optarg);
+            if (engineOption < 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'H':
+            hashOption = optarg;
+            if (parseHash(hashOption) == NULL) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's':
+            stripeOption = atoi(optarg);
+            if (stripeOption < 1) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'p':
+            parsers = atoi(optarg);
+            break;
+        case 'o':
+            ordered = 1;
+            break;
+        case 'n':
+            tracing = 0;
+            break;
+        case 'C':
+            convertPath = optarg;
+            break;
+        default:
+            printUsage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc) {
+        commandsPath = argv[optind];
+    }
+    if (workers < 1 || queueDepth < 1 || parsers < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    workerCount = workers;
+
+    // Map the command file, its records point straight into it. Text and binary files are both accepted.
+    commands = commandOpen(commandsPath);
+    if (commands == NULL) {
+        fprintf(stderr, "Error: couldn't open %s.\n", commandsPath);
+        return 1;
+    }
+
+    // Initialize command reader parameters
+    commandRecord cmd;
+    char name[64];
+
+    // Read the table size from the first command
+    if (!commandNext(commands, &cmd) || cmd.op != CMD_THREADS) {
+        fprintf(stderr, "Error: %s must start with a threads line.\n", commandsPath);
+        commandClose(commands);
+        return 1;
+    }
+    commandKeyCopy(&cmd, name, sizeof(name));
+    int threads = atoi(name);
+
+    // Table options, the threads line sets the initial bucket count
+    chashOptions options;
+    chashDefaultOptions(&options);
+    options.capacity = threads > 0 ? threads : 1;
+    options.stripes = stripeOption;
+    char hashLine[64];
+
+    // Engine, hash and keys lines right after the threads line pick the storage engine,
+    // hash function and key type, unless the first two were chosen on the command line
+    size_t bodyStart = commands->position;
+    int pending = commandNext(commands, &cmd);
+    while (pending && (cmd.op == CMD_ENGINE || cmd.op == CMD_HASH || cmd.op == CMD_KEYS)) {
+        commandKeyCopy(&cmd, name, sizeof(name));
+        if (cmd.op == CMD_ENGINE) {
+            int engine = parseEngine(name);
+            if (engine < 0) {
+                fprintf(stderr, "Error: unknown engine %s.\n", name);
+                return 1;
+            }
+            options.engine = engine;
+        }
+        else if (cmd.op == CMD_KEYS) {
+            int keys = parseKeys(name);
+            if (keys < 0) {
+                fprintf(stderr, "Error: unknown key type %s.\n", name);
+                return 1;
+            }
+            options.keys = keys;
+        }
+        else {
+            if (parseHash(name) == NULL) {
+                fprintf(stderr, "Error: unknown hash %s.\n", name);
+                return 1;
+            }
+            strcpy(hashLine, name);
+            options.hash = hashLine;
+        }
+        bodyStart = commands->position;
+        pending = commandNext(commands, &cmd);
+    }
+    if (engineOption >= 0) {
+        options.engine = engineOption;
+    }
+    if (hashOption != NULL) {
+        options.hash = hashOption;
+    }
+    hashFunction keyHash = parseHash(options.hash != NULL ? options.hash : DEFAULT_HASH);
+    if (keyHash == NULL) {
+        fprintf(stderr, "Error: unknown default hash %s.\n", DEFAULT_HASH);
+        return 1;
+    }
+
+    // Integer keys are hashed by value, not by their text, so their files never carry precomputed hashes
+    integerKeys = options.keys == CHASH_KEYS_INTEGER;
+    int hashId = integerKeys ? HASH_ID_NONE : hashFunctionId(keyHash);
+
+    // Converting writes the whole file out in the binary format, hashed for this run's hash function, and stops
+    if (convertPath != NULL) {
+        long converted = commandConvert(commands, convertPath, keyHash, hashId);
+        commandClose(commands);
+        if (converted < 0) {
+            fprintf(stderr, "Error: couldn't write %s.\n", convertPath);
+            return 1;
+        }
+        printf("Converted %ld commands to %s.\n", converted, convertPath);
+        return 0;
+    }
+
+    // Hashes precomputed by a binary file only stand in for the hash function they were made with
+    commands->trustHashes = commands->hashId != HASH_ID_NONE && commands->hashId == hashId;
+
+    // Open output file for writing
+    output = fopen("output.txt", "w");
+    if (output == NULL) {
+        fprintf(stderr, "Error: couldn't open output.txt.\n");
+        commandClose(commands);
+        return 1;
+    }
+
+    // Workers log into their own buffers and a background thread writes them out
+    if (logStart(output, tracing) != 0) {
+        fprintf(stderr, "Error: couldn't start the log writer.\n");
+        commandClose(commands);
+        fclose(output);
+        return 1;
+    }
+
+    logPrintf("Running %d threads\n", workers);
+
+    // Create the stripe locks and the hash table, which grows from here as it fills.
+    // Stripes default to a few per core, independent of the threads line.
+    table = chashCreate(&options);
+    if (table == NULL) {
+        fprintf(stderr, "Error: couldn't create the hash table. The threads line or stripe count may be too large.\n");
+        return 1;
+    }
+
+    // Hand over the header so it is written before anything the workers log
+    logFlush();
+
+    // Start the worker pool that executes the commands
+    // Ordered runs give every worker its own lane, so each key's commands run in file order
+    workerPool* pool = ordered ? poolCreateLanes(workers, queueDepth, sizeof(commandRecord), handleCommands)
+                               : poolCreate(workers, queueDepth, sizeof(commandRecord), handleCommands);
+    if (pool == NULL) {
+        fprintf(stderr, "Error: couldn't start the worker pool.\n");
+        return 1;
+    }
+
+    // Parse the remaining commands and hand them to the pool by value.
+    // Keys point into the command file, which stays mapped until the workers are done.
+    if (pending) {
+        parseCommands(commands, bodyStart, pool, parsers, ordered);
+    }
+
+    // Wait for the queue to drain and join all workers
+    poolShutdown(pool);
+
+    // Log that all threads have finished
+    logPrintf("Finished all threads.\n\n");
+
+    // Print the number of lock acquisitions and releases, and where time went waiting on them
+    printStats();
+
+    // Print the hash table
+    printTable();
+
+    // Clean up resources
+    logStop();
+    commandClose(commands);
+    fclose(output);
+    chashDestroy(table);
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+
+// Function that every worker thread runs until the pool is shut down.
+static void* poolWorker(void* arg) {
+    poolQueue* queue = (poolQueue*)arg;
+    workerPool* pool = queue->pool;
+
+    // Each worker copies its items out of the ring so the slots can be reused
+    char* items = malloc(POOL_BATCH_ITEMS * pool->itemSize);
+    if (items == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to worker item.\n");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        // Sleep until there is work or the producer has finished
+        while (queue->count == 0 && !pool->closed) {
+            pthread_cond_wait(&queue->notEmpty, &queue->lock);
+        }
+
+        // Queue drained and no more items are coming
+        if (queue->count == 0) {
+            break;
+        }
+
+        // Take a run from the head of the ring, leaving the other workers on the queue their share
+        int run = (queue->count + queue->workers - 1) / queue->workers;
+        if (run > POOL_BATCH_ITEMS) {
+            run = POOL_BATCH_ITEMS;
+        }
+        if (run > pool->capacity - queue->head) {
+            run = pool->capacity - queue->head;
+        }
+
+        memcpy(items, queue->items + (size_t)queue->head * pool->itemSize, (size_t)run * pool->itemSize);
+        queue->head = (queue->head + run) % pool->capacity;
+        queue->count -= run;
+        queue->busy++;
+
+        if (run > 1) {
+            pthread_cond_broadcast(&queue->notFull);
+        }
+        else {
+            pthread_cond_signal(&queue->notFull);
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        // Run the handler outside of the queue lock
+        pool->handler(items, run);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->busy--;
+        if (queue->count == 0 && queue->busy == 0) {
+            pthread_cond_broadcast(&queue->idle);
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    free(items);
+    return NULL;
+}
+
+// Function that creates the queues and starts the workers, worker i serving queue i % queueCount.
+static workerPool* poolStart(int workerCount, int queueCount, int capacity, size_t itemSize, poolHandler handler) {
+    if (workerCount < 1 || capacity < 1 || itemSize == 0) {
+        fprintf(stderr, "Error: invalid worker pool parameters.\n");
+        return NULL;
+    }
+
+    workerPool* pool = (workerPool*)calloc(1, sizeof(workerPool));
+    if (pool == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to worker pool.\n");
+        return NULL;
+    }
+
+    pool->workers = (pthread_t*)malloc(workerCount * sizeof(pthread_t));
+    pool->queues = (poolQueue*)aligned_alloc(64, queueCount * sizeof(poolQueue));
+    if (pool->workers == NULL || pool->queues == NULL) {
+        fprintf(stderr, "Error: couldn't allocate memory to worker pool.\n");
+        free(pool->workers);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+    memset(pool->queues, 0, queueCount * sizeof(poolQueue));
+
+    pool->itemSize = itemSize;
+    pool->capacity = capacity;
+    pool->handler = handler;
+
+    for (int i = 0; i < queueCount; i++) {
+        poolQueue* queue = &pool->queues[i];
+        queue->pool = pool;
+        queue->items = (char*)malloc((size_t)capacity * itemSize);
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->notEmpty, NULL);
+        pthread_cond_init(&queue->notFull, NULL);
+        pthread_cond_init(&queue->idle, NULL);
+        pool->queueCount++;
+
+        if (queue->items == NULL) {
+            fprintf(stderr, "Error: couldn't allocate memory to worker pool.\n");
+            poolShutdown(pool);
+            return NULL;
+        }
+    }
+
+    // Start the workers, keeping however many were created if one fails
+    // A queue counts its workers before they start, since they read the count to size their runs
+    for (int i = 0; i < workerCount; i++) {
+        poolQueue* queue = &pool->queues[i % queueCount];
+        pthread_mutex_lock(&queue->lock);
+        queue->workers++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (pthread_create(&pool->workers[i], NULL, poolWorker, queue) != 0) {
+            fprintf(stderr, "Error: couldn't create worker %d.\n", i);
+            pthread_mutex_lock(&queue->lock);
+            queue->workers--;
+            pthread_mutex_unlock(&queue->lock);
+            break;
+        }
+        pool->workerCount++;
+    }
+
+    if (pool->workerCount == 0) {
+        poolShutdown(pool);
+        return NULL;
+    }
+
+    // Lanes without a worker would never drain, so only the served ones take items
+    pool->laneCount = pool->workerCount < pool->queueCount ? pool->workerCount : pool->queueCount;
+
+    return pool;
+}
+
+// Function that creates one queue shared by every worker.
+workerPool* poolCreate(int workerCount, int capacity, size_t itemSize, poolHandler handler) {
+    return poolStart(workerCount, 1, capacity, itemSize, handler);
+}
+
+// Function that creates a separate lane for every worker.
+workerPool* poolCreateLanes(int workerCount, int capacity, size_t itemSize, poolHandler handler) {
+    return poolStart(workerCount, workerCount, capacity, itemSize, handler);
+}
+
+// Function that copies items into one lane in order, blocking while it is full.
+// Items are moved in as large runs as fit, so the lock is taken once per run rather than per item.
+int poolSubmitMany(workerPool* pool, int lane, const void* items, int count) {
+    poolQueue* queue = &pool->queues[lane % pool->laneCount];
+    const char* next = (const char*)items;
+
+    pthread_mutex_lock(&queue->lock);
+
+    while (count > 0) {
+        while (queue->count == pool->capacity && !pool->closed) {
+            pthread_cond_wait(&queue->notFull, &queue->lock);
+        }
+
+        if (pool->closed) {
+            pthread_mutex_unlock(&queue->lock);
+            return -1;
+        }
+
+        // Copy up to the end of the free space or the end of the ring, whichever is first
+        int run = pool->capacity - queue->count;
+        if (run > pool->capacity - queue->tail) {
+            run = pool->capacity - queue->tail;
+        }
+        if (run > count) {
+            run = count;
+        }
+
+        memcpy(queue->items + (size_t)queue->tail * pool->itemSize, next, (size_t)run * pool->itemSize);
+        queue->tail = (queue->tail + run) % pool->capacity;
+        queue->count += run;
+        next += (size_t)run * pool->itemSize;
+        count -= run;
+
+        if (run > 1) {
+            pthread_cond_broadcast(&queue->notEmpty);
+        }
+        else {
+            pthread_cond_signal(&queue->notEmpty);
+        }
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+// Function that waits until every item submitted so far has been handled, on every lane.
+// Only the submitting thread may call it, since items submitted meanwhile would be waited for too.
+void poolDrain(workerPool* pool) {
+    for (int i = 0; i < pool->laneCount; i++) {
+        poolQueue* queue = &pool->queues[i];
+
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count > 0 || queue->busy > 0) {
+            pthread_cond_wait(&queue->idle, &queue->lock);
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+// Function that lets the workers drain the queues, joins them and frees the pool.
+void poolShutdown(workerPool* pool) {
+    if (pool == NULL)
+        return;
+
+    int queueCount = pool->queueCount;
+
+    for (int i = 0; i < queueCount; i++) {
+        pthread_mutex_lock(&pool->queues[i].lock);
+    }
+    pool->closed = 1;
+    for (int i = 0; i < queueCount; i++) {
+        pthread_cond_broadcast(&pool->queues[i].notEmpty);
+        pthread_cond_broadcast(&pool->queues[i].notFull);
+        pthread_mutex_unlock(&pool->queues[i].lock);
+    }
+
+    for (int i = 0; i < pool->workerCount; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    for (int i = 0; i < queueCount; i++) {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+        pthread_cond_destroy(&pool->queues[i].notEmpty);
+        pthread_cond_destroy(&pool->queues[i].notFull);
+        pthread_cond_destroy(&pool->queues[i].idle);
+        free(pool->queues[i].items);
+    }
+    free(pool->workers);
+    free(pool->queues);
+    free(pool);
+}
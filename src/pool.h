@@ -0,0 +1,60 @@
+// Worker Pool Definitions
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// Most items a worker takes off its queue at once
+#define POOL_BATCH_ITEMS 64
+
+// Function run by a worker for every run of items taken off the queue, in queue order.
+typedef void (*poolHandler)(void* items, int count);
+
+// Bounded ring buffer feeding one or more workers
+typedef struct pool_queue
+{
+	struct worker_pool* pool;
+
+	char* items;
+	int head;
+	int tail;
+	int count;
+	int workers;
+
+	// Workers running a handler on items already taken off this queue
+	int busy;
+
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+	pthread_cond_t idle;
+
+} __attribute__((aligned(64))) poolQueue;
+
+// Fixed set of long-lived workers. Either every worker shares one queue, or each
+// worker owns a lane of its own, so items submitted to one lane run in order.
+typedef struct worker_pool
+{
+	pthread_t* workers;
+	int workerCount;
+
+	poolQueue* queues;
+	int queueCount;
+	int laneCount;
+	size_t itemSize;
+	int capacity;
+	int closed;
+
+	poolHandler handler;
+
+} workerPool;
+
+// Function Prototypes
+workerPool* poolCreate(int workerCount, int capacity, size_t itemSize, poolHandler handler);
+workerPool* poolCreateLanes(int workerCount, int capacity, size_t itemSize, poolHandler handler);
+int poolSubmitMany(workerPool* pool, int lane, const void* items, int count);
+void poolDrain(workerPool* pool);
+void poolShutdown(workerPool* pool);
+
+#endif
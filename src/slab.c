@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "slab.h"
+
+// Objects start on the first cache line after the slab header.
+#define SLAB_FIRST_OBJECT 64
+
+// Function that returns the slab an object was carved from.
+static slabHeader* slabOf(void* object) {
+    return (slabHeader*)((uintptr_t)object & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+// Function that allocates an empty cache for a thread taking its first object.
+static localRecord* slabCreateCache(void* context) {
+    (void)context;
+    return (localRecord*)calloc(1, sizeof(slabCache));
+}
+
+// Function that carves a new slab into the cache's local free list.
+static int slabGrow(slabPool* pool, slabCache* cache) {
+    slabHeader* slab = (slabHeader*)aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+    if (slab == NULL) {
+        return -1;
+    }
+
+    slab->owner = cache;
+
+    pthread_mutex_lock(&pool->lock);
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pthread_mutex_unlock(&pool->lock);
+
+    // Thread the objects back to front so they are handed out in address order
+    char* base = (char*)slab + SLAB_FIRST_OBJECT;
+    for (size_t i = (SLAB_SIZE - SLAB_FIRST_OBJECT) / pool->objectSize; i > 0; i--) {
+        slabObject* object = (slabObject*)(base + (i - 1) * pool->objectSize);
+        object->next = cache->localFree;
+        cache->localFree = object;
+    }
+
+    return 0;
+}
+
+// Function that creates an allocator for objects of one size.
+slabPool* slabCreate(size_t objectSize) {
+    slabPool* pool = (slabPool*)calloc(1, sizeof(slabPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    // Objects are pointer-aligned and must hold the free-list link
+    if (objectSize < sizeof(slabObject)) {
+        objectSize = sizeof(slabObject);
+    }
+    pool->objectSize = (objectSize + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    if (pool->objectSize > SLAB_SIZE - SLAB_FIRST_OBJECT || localRegister(&pool->caches, slabCreateCache, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+// Function that hands out one object from this thread's cache.
+void* slabAlloc(slabPool* pool) {
+    slabCache* cache = (slabCache*)localSelf(&pool->caches);
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    // Take back everything other threads have returned before carving a new slab
+    if (cache->localFree == NULL) {
+        cache->localFree = atomic_exchange(&cache->remoteFree, NULL);
+    }
+    if (cache->localFree == NULL && slabGrow(pool, cache) != 0) {
+        return NULL;
+    }
+
+    slabObject* object = cache->localFree;
+    cache->localFree = object->next;
+    return object;
+}
+
+// Function that returns an object to the cache of the thread that carved its slab.
+void slabRelease(slabPool* pool, void* object) {
+    if (object == NULL)
+        return;
+
+    slabCache* owner = slabOf(object)->owner;
+    slabObject* freed = (slabObject*)object;
+
+    // The owner's own frees need no synchronization
+    if (owner == (slabCache*)localFind(&pool->caches)) {
+        freed->next = owner->localFree;
+        owner->localFree = freed;
+        return;
+    }
+
+    // Other threads only ever push, and the owner takes the whole list at once, so there is no ABA
+    slabObject* head = atomic_load_explicit(&owner->remoteFree, memory_order_relaxed);
+    do {
+        freed->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&owner->remoteFree, &head, freed, memory_order_release, memory_order_relaxed));
+}
+
+// Function that releases every slab at once, along with any objects still in use.
+void slabDestroy(slabPool* pool) {
+    if (pool == NULL)
+        return;
+
+    while (pool->slabs != NULL) {
+        slabHeader* next = pool->slabs->next;
+        free(pool->slabs);
+        pool->slabs = next;
+    }
+
+    localUnregister(&pool->caches);
+    localRecord* cache = atomic_exchange(&pool->caches.records, NULL);
+    while (cache != NULL) {
+        localRecord* next = cache->next;
+        free(cache);
+        cache = next;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
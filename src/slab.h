@@ -0,0 +1,57 @@
+// Slab Allocator Definitions
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "local.h"
+
+// Slabs are aligned to their size so an object finds its slab by masking its address
+#define SLAB_SIZE (64 * 1024)
+
+// Link threaded through free objects
+typedef struct slab_object
+{
+	struct slab_object* next;
+
+} slabObject;
+
+// Per-thread cache. Only the owner pops; other threads hand objects back through remoteFree.
+typedef struct slab_cache
+{
+	localRecord link;
+	slabObject* localFree;
+	_Atomic(slabObject*) remoteFree;
+
+} slabCache;
+
+// Header at the start of every slab
+typedef struct slab_header
+{
+	slabCache* owner;
+	struct slab_header* next;
+
+} slabHeader;
+
+// Fixed-size object allocator
+typedef struct slab_pool
+{
+	size_t objectSize;
+
+	// Every thread's cache
+	localDomain caches;
+
+	// Only taken when a thread adds a slab
+	pthread_mutex_t lock;
+	slabHeader* slabs;
+
+} slabPool;
+
+// Function Prototypes
+slabPool* slabCreate(size_t objectSize);
+void* slabAlloc(slabPool* pool);
+void slabRelease(slabPool* pool, void* object);
+void slabDestroy(slabPool* pool);
+
+#endif
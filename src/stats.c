@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+// Function that allocates a zeroed record with room for every stripe.
+static threadStats* statsRecord(int stripeCount) {
+    threadStats* record = (threadStats*)aligned_alloc(64, sizeof(threadStats));
+    if (record == NULL) {
+        return NULL;
+    }
+    memset(record, 0, sizeof(threadStats));
+
+    record->stripes = (stripeStats*)calloc(stripeCount, sizeof(stripeStats));
+    if (record->stripes == NULL) {
+        free(record);
+        return NULL;
+    }
+    return record;
+}
+
+// Function that allocates a record for a thread first recording into a domain.
+static localRecord* statsCreateRecord(void* context) {
+    return (localRecord*)statsRecord(((statsDomain*)context)->stripeCount);
+}
+
+// Function that returns this thread's record in a domain, registering it on first use.
+static threadStats* statsSelf(statsDomain* domain) {
+    threadStats* record = (threadStats*)localSelf(&domain->threads);
+    if (record == NULL) {
+        // Losing exact counts is better than failing the operation
+        fprintf(stderr, "Error: couldn't allocate memory to thread statistics.\n");
+        return &domain->fallback;
+    }
+    return record;
+}
+
+// Function that creates a domain whose records count every one of stripeCount stripes.
+statsDomain* statsCreate(int stripeCount) {
+    statsDomain* domain = (statsDomain*)aligned_alloc(64, sizeof(statsDomain));
+    if (domain == NULL) {
+        return NULL;
+    }
+    memset(domain, 0, sizeof(statsDomain));
+
+    domain->fallback.stripes = (stripeStats*)calloc(stripeCount, sizeof(stripeStats));
+    domain->stripeCount = stripeCount;
+    if (domain->fallback.stripes == NULL || localRegister(&domain->threads, statsCreateRecord, domain) != 0) {
+        free(domain->fallback.stripes);
+        free(domain);
+        return NULL;
+    }
+
+    return domain;
+}
+
+// Function that counts one table operation.
+void statsCountOperation(statsDomain* domain, int operation) {
+    statsSelf(domain)->operations[operation]++;
+}
+
+// Function that records a stripe lock being taken, how long it took and
+// whether the first try found it held.
+void statsLockAcquired(statsDomain* domain, int stripe, uint64_t waitNanos, int contended) {
+    threadStats* record = statsSelf(domain);
+    stripeStats* counters = &record->stripes[stripe];
+
+    record->lockAcquisitions++;
+    counters->acquisitions++;
+    counters->trylockFailures += contended != 0;
+    counters->waitNanos += waitNanos;
+}
+
+// Function that records a stripe lock being released after being held for holdNanos.
+void statsLockReleased(statsDomain* domain, int stripe, uint64_t holdNanos) {
+    threadStats* record = statsSelf(domain);
+
+    record->lockReleases++;
+    record->stripes[stripe].holdNanos += holdNanos;
+}
+
+// Function that adds one record's counters into the totals.
+static void statsAdd(threadStats* totals, const threadStats* record, int stripeCount) {
+    totals->lockAcquisitions += record->lockAcquisitions;
+    totals->lockReleases += record->lockReleases;
+
+    for (int i = 0; i < STAT_OPERATION_COUNT; i++) {
+        totals->operations[i] += record->operations[i];
+    }
+
+    for (int i = 0; i < stripeCount; i++) {
+        totals->stripes[i].acquisitions += record->stripes[i].acquisitions;
+        totals->stripes[i].trylockFailures += record->stripes[i].trylockFailures;
+        totals->stripes[i].waitNanos += record->stripes[i].waitNanos;
+        totals->stripes[i].holdNanos += record->stripes[i].holdNanos;
+    }
+}
+
+// Function that merges every thread's counters into a new record.
+// The counts are exact once the threads that recorded them have been joined.
+threadStats* statsCollect(statsDomain* domain) {
+    threadStats* totals = statsRecord(domain->stripeCount);
+    if (totals == NULL) {
+        return NULL;
+    }
+
+    for (localRecord* record = atomic_load(&domain->threads.records); record != NULL; record = record->next) {
+        statsAdd(totals, (threadStats*)record, domain->stripeCount);
+    }
+    statsAdd(totals, &domain->fallback, domain->stripeCount);
+
+    return totals;
+}
+
+// Function that frees a record returned by statsCollect().
+void statsFree(threadStats* totals) {
+    if (totals == NULL)
+        return;
+
+    free(totals->stripes);
+    free(totals);
+}
+
+// Function that frees every thread's record and the domain. Only called once no thread records any more.
+void statsDestroy(statsDomain* domain) {
+    if (domain == NULL)
+        return;
+
+    localUnregister(&domain->threads);
+    threadStats* record = (threadStats*)atomic_exchange(&domain->threads.records, NULL);
+
+    while (record != NULL) {
+        threadStats* next = (threadStats*)record->link.next;
+        statsFree(record);
+        record = next;
+    }
+
+    free(domain->fallback.stripes);
+    free(domain);
+}
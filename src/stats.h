@@ -0,0 +1,63 @@
+// Statistics Definitions
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "local.h"
+
+// Operations counted per thread
+#define STAT_INSERT 0
+#define STAT_DELETE 1
+#define STAT_SEARCH 2
+#define STAT_PRINT 3
+#define STAT_UPDATE 4
+#define STAT_OPERATION_COUNT 5
+
+// Contention figures for one lock stripe
+typedef struct stripe_stats
+{
+	uint64_t acquisitions;
+	uint64_t trylockFailures;
+	uint64_t waitNanos;
+	uint64_t holdNanos;
+
+} stripeStats;
+
+// Counters owned by one thread. Only the owner writes them, so no increment is atomic,
+// and each record sits on its own cache lines.
+typedef struct thread_stats
+{
+	localRecord link;
+	uint64_t lockAcquisitions;
+	uint64_t lockReleases;
+	uint64_t operations[STAT_OPERATION_COUNT];
+	stripeStats* stripes;
+
+} __attribute__((aligned(64))) threadStats;
+
+// Counters of one table, kept apart from every other table's
+typedef struct stats_domain
+{
+	// Number of lock stripes every record keeps counters for
+	int stripeCount;
+
+	// Every thread that has recorded anything
+	localDomain threads;
+
+	// Shared record counted into when a thread can't get one of its own
+	threadStats fallback;
+
+} statsDomain;
+
+// Function Prototypes
+statsDomain* statsCreate(int stripeCount);
+void statsCountOperation(statsDomain* domain, int operation);
+void statsLockAcquired(statsDomain* domain, int stripe, uint64_t waitNanos, int contended);
+void statsLockReleased(statsDomain* domain, int stripe, uint64_t holdNanos);
+threadStats* statsCollect(statsDomain* domain);
+void statsFree(threadStats* totals);
+void statsDestroy(statsDomain* domain);
+
+#endif
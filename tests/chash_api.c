@@ -0,0 +1,251 @@
+// Behavior checks for the C interface of libchash, run by make check
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chash.h"
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			exit(1); \
+		} \
+	} while (0)
+
+// Keys in the batch checks, enough to grow a small table several times over
+#define BATCH_KEYS 600
+
+// Keys in the integer checks
+#define INTEGER_KEYS 2000
+
+// Function that creates a small table, so the chained engine resizes while the checks run.
+static chashTable* createTable(int engine, int keys) {
+	chashOptions options;
+	chashDefaultOptions(&options);
+	options.engine = engine;
+	options.keys = keys;
+	options.stripes = 4;
+	options.capacity = 4;
+
+	chashTable* table = chashCreate(&options);
+	CHECK(table != NULL);
+	return table;
+}
+
+// Function that checks the batch insert, delete and search calls, with and without given hashes.
+static void checkBatches(int engine) {
+	chashTable* table = createTable(engine, CHASH_KEYS_STRING);
+
+	static char names[BATCH_KEYS][32];
+	const uint8_t* keys[BATCH_KEYS];
+	size_t lengths[BATCH_KEYS];
+	uint32_t hashes[BATCH_KEYS];
+	uint32_t values[BATCH_KEYS];
+	uint32_t salaries[BATCH_KEYS];
+	uint8_t found[BATCH_KEYS];
+
+	// Every third key is a long one, and the first key has a salary of 0
+	for (int i = 0; i < BATCH_KEYS; i++) {
+		snprintf(names[i], sizeof(names[i]), i % 3 == 0 ? "long batch key number %d" : "key%d", i);
+		keys[i] = (const uint8_t*)names[i];
+		lengths[i] = strlen(names[i]);
+		hashes[i] = chashHash(table, keys[i], lengths[i]);
+		values[i] = (uint32_t)i * 10;
+	}
+
+	chashInsertBatch(table, keys, lengths, NULL, values, BATCH_KEYS);
+	chashSearchBatch(table, keys, lengths, hashes, BATCH_KEYS, salaries, found);
+	for (int i = 0; i < BATCH_KEYS; i++) {
+		CHECK(found[i] == 1);
+		CHECK(salaries[i] == values[i]);
+	}
+
+	// A key repeated in one batch keeps its operations in batch order
+	const uint8_t* repeated[] = { keys[1], keys[2], keys[1] };
+	size_t repeatedLengths[] = { lengths[1], lengths[2], lengths[1] };
+	uint32_t repeatedValues[] = { 7, 8, 9 };
+	chashInsertBatch(table, repeated, repeatedLengths, NULL, repeatedValues, 3);
+	uint32_t salary = 0;
+	CHECK(chashSearch(table, keys[1], lengths[1], &salary) == 1 && salary == 9);
+	CHECK(chashSearch(table, keys[2], lengths[2], &salary) == 1 && salary == 8);
+
+	// Delete the even keys, then a missing key reads back as not found with a salary of 0
+	const uint8_t* evenKeys[BATCH_KEYS / 2];
+	size_t evenLengths[BATCH_KEYS / 2];
+	uint32_t evenHashes[BATCH_KEYS / 2];
+	for (int i = 0; i < BATCH_KEYS / 2; i++) {
+		evenKeys[i] = keys[i * 2];
+		evenLengths[i] = lengths[i * 2];
+		evenHashes[i] = hashes[i * 2];
+	}
+	chashDeleteBatch(table, evenKeys, evenLengths, evenHashes, BATCH_KEYS / 2);
+
+	memset(salaries, 0xff, sizeof(salaries));
+	chashSearchBatch(table, keys, lengths, NULL, BATCH_KEYS, salaries, found);
+	for (int i = 2; i < BATCH_KEYS; i++) {
+		CHECK(found[i] == (i % 2));
+		CHECK(salaries[i] == (i % 2 ? values[i] : 0));
+	}
+
+	// Found may be left out
+	chashSearchBatch(table, keys, lengths, hashes, 2, salaries, NULL);
+	CHECK(salaries[0] == 0 && salaries[1] == 9);
+
+	chashDestroy(table);
+}
+
+// Function that checks lookups that tell a missing key from a salary of 0, and the atomic updates.
+static void checkLookups(int engine) {
+	chashTable* table = createTable(engine, CHASH_KEYS_STRING);
+	const uint8_t* zero = (const uint8_t*)"Unpaid Intern";
+	const uint8_t* missing = (const uint8_t*)"Nobody";
+	const uint8_t* counter = (const uint8_t*)"counter";
+	uint32_t salary = 123;
+
+	// A salary of 0 is found, a missing key is not and leaves the salary alone
+	chashInsert(table, zero, 13, 0);
+	CHECK(chashSearch(table, zero, 13, &salary) == 1 && salary == 0);
+	salary = 123;
+	CHECK(chashSearch(table, missing, 6, &salary) == 0 && salary == 123);
+	CHECK(chashDelete(table, missing, 6) == 0);
+
+	// Get-or-insert reports an existing salary, even 0, and only inserts a missing key
+	uint32_t existing = 99;
+	CHECK(chashGetOrInsert(table, zero, 13, 5, &existing) == 1 && existing == 0);
+	CHECK(chashGetOrInsert(table, missing, 6, 5, &existing) == 0);
+	CHECK(chashSearch(table, missing, 6, &salary) == 1 && salary == 5);
+
+	// Compare-and-swap tells a mismatch from a missing key
+	uint32_t current = 0;
+	CHECK(chashCompareAndSwap(table, missing, 6, 4, 6, &current) == 0 && current == 5);
+	CHECK(chashCompareAndSwap(table, missing, 6, 5, 6, &current) == 1 && current == 5);
+	CHECK(chashSearch(table, missing, 6, &salary) == 1 && salary == 6);
+	CHECK(chashCompareAndSwap(table, counter, 7, 0, 1, NULL) == -1);
+	CHECK(chashSearch(table, counter, 7, &salary) == 0);
+
+	// Fetch-add inserts a missing key with the delta and wraps like any unsigned value
+	CHECK(chashFetchAdd(table, counter, 7, 3) == 0);
+	CHECK(chashFetchAdd(table, counter, 7, 4) == 3);
+	CHECK(chashAddFetch(table, counter, 7, 5) == 12);
+	CHECK(chashFetchAdd(table, counter, 7, UINT32_MAX) == 12);
+	CHECK(chashSearch(table, counter, 7, &salary) == 1 && salary == 11);
+
+	// The hashed forms agree with the plain ones
+	uint32_t hash = chashHash(table, counter, 7);
+	CHECK(chashSearchHashed(table, counter, 7, hash, &salary) == 1 && salary == 11);
+	CHECK(chashFetchAddHashed(table, counter, 7, hash, 1) == 11);
+	CHECK(chashDeleteHashed(table, counter, 7, hash) == 1);
+	CHECK(chashSearch(table, counter, 7, &salary) == 0);
+
+	chashDestroy(table);
+}
+
+// Function that checks every integer call, on 32-bit keys, 64-bit keys and both ends of the range.
+static void checkIntegers(int engine) {
+	chashTable* table = createTable(engine, CHASH_KEYS_INTEGER);
+	uint32_t salary = 0;
+
+	// Spread the keys over the whole 64-bit range, so the high bits matter to the hash
+	for (uint64_t i = 0; i < INTEGER_KEYS; i++) {
+		chashInsertInteger(table, i * 0x100000001ull, (uint32_t)i);
+	}
+	for (uint64_t i = 0; i < INTEGER_KEYS; i++) {
+		CHECK(chashSearchInteger(table, i * 0x100000001ull, &salary) == 1 && salary == (uint32_t)i);
+	}
+	CHECK(chashSearchInteger(table, 1, &salary) == 0);
+
+	// A 32-bit key widens to the same entry as its 64-bit value
+	uint32_t narrow = 4000000000u;
+	chashInsertInteger(table, narrow, 1);
+	CHECK(chashSearchInteger(table, (uint64_t)4000000000u, &salary) == 1 && salary == 1);
+	CHECK(chashDeleteInteger(table, narrow) == 1);
+	CHECK(chashDeleteInteger(table, narrow) == 0);
+
+	// Both ends of the range are keys like any other
+	chashInsertInteger(table, UINT64_MAX, 7);
+	CHECK(chashSearchInteger(table, UINT64_MAX, &salary) == 1 && salary == 7);
+	CHECK(chashSearchInteger(table, 0, &salary) == 1 && salary == 0);
+
+	uint32_t existing = 0;
+	CHECK(chashGetOrInsertInteger(table, UINT64_MAX, 1, &existing) == 1 && existing == 7);
+	CHECK(chashGetOrInsertInteger(table, 3, 30, &existing) == 0);
+
+	uint32_t current = 0;
+	CHECK(chashCompareAndSwapInteger(table, 3, 31, 32, &current) == 0 && current == 30);
+	CHECK(chashCompareAndSwapInteger(table, 3, 30, 32, &current) == 1);
+	CHECK(chashCompareAndSwapInteger(table, 5, 0, 1, &current) == -1);
+
+	CHECK(chashFetchAddInteger(table, 3, 8) == 32);
+	CHECK(chashFetchAddInteger(table, 5, 8) == 0);
+	CHECK(chashSearchInteger(table, 3, &salary) == 1 && salary == 40);
+	CHECK(chashSearchInteger(table, 5, &salary) == 1 && salary == 8);
+
+	// Integer keys are hashed by value, not by their bytes with the string hash
+	uint64_t key = 3;
+	CHECK(chashHash(table, (const uint8_t*)&key, sizeof(key)) == chashIntegerHash(key));
+
+	chashDestroy(table);
+}
+
+// Function that counts the entries chashForEach() visits.
+static void countEntry(void* context, uint32_t hash, const char* key, size_t length, uint32_t value) {
+	(void)hash;
+	(void)key;
+	(void)length;
+	(void)value;
+	(*(size_t*)context)++;
+}
+
+// Function that checks a snapshot copies every entry, with its hash, salary and a NUL-terminated name.
+static void checkSnapshot(int engine) {
+	chashTable* table = createTable(engine, CHASH_KEYS_STRING);
+	size_t count = 1;
+
+	// An empty table gives no array
+	CHECK(chashSnapshot(table, &count) == NULL && count == 0);
+
+	char name[64];
+	for (int i = 0; i < 100; i++) {
+		snprintf(name, sizeof(name), i % 2 ? "snapshot entry with a long name %d" : "entry%d", i);
+		chashInsert(table, (const uint8_t*)name, strlen(name), (uint32_t)i);
+	}
+	chashDelete(table, (const uint8_t*)"entry0", 6);
+
+	chashEntry* entries = chashSnapshot(table, &count);
+	CHECK(entries != NULL && count == 99);
+
+	size_t visited = 0;
+	chashForEach(table, countEntry, &visited);
+	CHECK(visited == count);
+
+	int seen[100] = { 0 };
+	for (size_t i = 0; i < count; i++) {
+		chashEntry* entry = &entries[i];
+		CHECK(entry->name[entry->length] == '\0' && strlen(entry->name) == entry->length);
+		CHECK(entry->hash == chashHash(table, (const uint8_t*)entry->name, entry->length));
+		CHECK(entry->salary > 0 && entry->salary < 100 && !seen[entry->salary]);
+		seen[entry->salary] = 1;
+
+		snprintf(name, sizeof(name), entry->salary % 2 ? "snapshot entry with a long name %u" : "entry%u", entry->salary);
+		CHECK(strcmp(entry->name, name) == 0);
+	}
+
+	// The copies outlive the table
+	chashDestroy(table);
+	CHECK(entries[0].length > 0);
+	chashFreeSnapshot(entries, count);
+}
+
+int main(void) {
+	const int engines[] = { CHASH_ENGINE_CHAINED, CHASH_ENGINE_FLAT };
+
+	for (int i = 0; i < 2; i++) {
+		checkBatches(engines[i]);
+		checkLookups(engines[i]);
+		checkIntegers(engines[i]);
+		checkSnapshot(engines[i]);
+	}
+
+	printf("chash_api: ok\n");
+	return 0;
+}
@@ -0,0 +1,203 @@
+// Behavior checks for the C++ concurrent_map, run by make check
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "chash.hpp"
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			std::exit(1); \
+		} \
+	} while (0)
+
+// Flat engine with a few stripes, so both engines are exercised
+struct flat_traits : chash::default_traits
+{
+	static constexpr int engine = CHASH_ENGINE_FLAT;
+	static constexpr int stripes = 4;
+};
+
+template <class Map>
+static void checkIntegerMap()
+{
+	Map map;
+
+	// Insert, search and erase, with a zero value still found
+	map.insert(1, 10);
+	map.insert(-2, 0);
+	map.insert(1, 11);
+	CHECK(map.search(1) == 11u);
+	CHECK(map.search(-2) == 0u);
+	CHECK(!map.search(3).has_value());
+	CHECK(map.erase(-2));
+	CHECK(!map.erase(-2));
+	CHECK(!map.contains(-2));
+
+	// Get-or-insert only inserts a missing key
+	CHECK(map.get_or_insert(1, 99) == 11u);
+	CHECK(map.get_or_insert(4, 40) == 40u);
+	CHECK(map.search(4) == 40u);
+
+	// Compare-exchange reports the value seen on a mismatch
+	std::uint32_t expected = 5;
+	CHECK(!map.compare_exchange(4, expected, 50));
+	CHECK(expected == 40u);
+	CHECK(map.compare_exchange(4, expected, 50));
+	CHECK(map.search(4) == 50u);
+	CHECK(!map.compare_exchange(7, expected, 1));
+
+	// Fetch-add inserts a missing key with the delta
+	CHECK(map.fetch_add(1, 5) == 11u);
+	CHECK(map.fetch_add(8, 3) == 0u);
+	CHECK(map.search(8) == 3u);
+
+	// The native handle sees the same entries under the table's own integer hash
+	std::uint32_t salary = 0;
+	CHECK(chashSearchInteger(map.native_handle(), 1, &salary) == 1 && salary == 16u);
+
+	// Compare-exchange retry loops from several threads lose no increments
+	const int threads = 4;
+	const int rounds = 2000;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([&map] {
+			for (int i = 0; i < rounds; i++) {
+				std::uint32_t current = map.get_or_insert(100, 0);
+				while (!map.compare_exchange(100, current, current + 1)) {
+				}
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	CHECK(map.search(100) == std::uint32_t(threads * rounds));
+
+	// For-each visits every entry once
+	long keys = 0;
+	long values = 0;
+	int count = 0;
+	map.for_each([&](int key, std::uint32_t value) {
+		keys += key;
+		values += value;
+		count++;
+	});
+	CHECK(count == 4);
+	CHECK(keys == 1 + 4 + 8 + 100);
+	CHECK(values == 16 + 50 + 3 + threads * rounds);
+}
+
+static void checkStringMap()
+{
+	chash::concurrent_map<std::string_view> map;
+	std::string longKey(80, 'k');
+
+	map.insert("alice", 1);
+	map.insert(longKey, 2);
+	CHECK(map.search("alice") == 1u);
+	CHECK(map.search(longKey) == 2u);
+	CHECK(!map.search(std::string_view(longKey).substr(0, 79)).has_value());
+
+	CHECK(map.fetch_add("alice", 4) == 1u);
+	CHECK(map.fetch_add("bob", 7) == 0u);
+	CHECK(map.search("alice") == 5u);
+	CHECK(map.search("bob") == 7u);
+
+	int count = 0;
+	std::size_t lengths = 0;
+	map.for_each([&](std::string_view key, std::uint32_t) {
+		lengths += key.size();
+		count++;
+	});
+	CHECK(count == 3);
+	CHECK(lengths == 5 + 80 + 3);
+}
+
+static void checkNarrowValues()
+{
+	// Narrow values wrap at their own width and the stored slot agrees with them
+	chash::concurrent_map<int, std::uint16_t> map;
+	map.insert(1, 65535);
+	CHECK(map.fetch_add(1, 1) == 65535);
+	CHECK(map.search(1) == 0);
+
+	std::uint32_t slot = 1;
+	CHECK(chashSearchInteger(map.native_handle(), 1, &slot) == 1 && slot == 0u);
+
+	std::uint16_t expected = 0;
+	CHECK(map.compare_exchange(1, expected, 7));
+	CHECK(map.search(1) == 7);
+
+	chash::concurrent_map<int, std::int8_t> signedMap;
+	signedMap.insert(2, 127);
+	CHECK(signedMap.fetch_add(2, 1) == 127);
+	CHECK(signedMap.search(2) == -128);
+}
+
+static void checkManyTables()
+{
+	// Tables share one thread key, so far more can be live than there are keys in the process
+	const int tables = 300;
+	std::vector<std::unique_ptr<chash::concurrent_map<int>>> maps;
+	for (int i = 0; i < tables; i++) {
+		maps.push_back(std::make_unique<chash::concurrent_map<int>>());
+	}
+
+	// A short-lived thread takes records in every table, then exits while the tables stay in use
+	std::thread writer([&maps] {
+		for (int i = 0; i < tables; i++) {
+			maps[i]->insert(i, std::uint32_t(i) * 2);
+		}
+	});
+	writer.join();
+
+	for (int i = 0; i < tables; i++) {
+		CHECK(maps[i]->search(i) == std::uint32_t(i) * 2);
+		CHECK(maps[i]->erase(i));
+	}
+}
+
+static void checkThreadChurn()
+{
+	// Each short-lived thread adopts the records the previous one left behind, including its slab cache,
+	// and frees string keys that an exited thread allocated
+	chash::concurrent_map<std::string_view> map;
+	std::vector<std::string> keys;
+	for (int i = 0; i < 64; i++) {
+		keys.push_back(std::string(40, 'a' + i % 26) + std::to_string(i));
+	}
+
+	for (int round = 0; round < 50; round++) {
+		std::thread worker([&map, &keys, round] {
+			for (std::size_t i = 0; i < keys.size(); i++) {
+				if (round > 0) {
+					CHECK(map.erase(keys[i]));
+				}
+				map.insert(keys[i], std::uint32_t(round));
+			}
+		});
+		worker.join();
+	}
+
+	for (const auto& key : keys) {
+		CHECK(map.search(key) == 49u);
+	}
+}
+
+int main()
+{
+	checkIntegerMap<chash::concurrent_map<int>>();
+	checkIntegerMap<chash::concurrent_map<int, std::uint32_t, chash::hash<int>, flat_traits>>();
+	checkStringMap();
+	checkNarrowValues();
+	checkManyTables();
+	checkThreadChurn();
+	std::printf("concurrent_map: ok\n");
+	return 0;
+}